@@ -0,0 +1,464 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "analyse.h"
+#include "generate.h"
+#include "events.h"
+#include "engine.h"
+#include "timing.h"
+
+// save file paths passed from the thread finding them to the workers
+typedef struct {
+    char** paths;           // a ring of "capacity" paths
+    int capacity;
+    int start;
+    int length;
+    Bool finished;          // no more paths will be added
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+} PathQueue;
+
+// what the workers share
+typedef struct {
+    const FitzTiles* tiles;
+    int bots[2];            // automated players finishing the games
+    FitzCache* cache;       // position cache the games share, or NULL
+    OutputFormat format;
+    char* engineType;       // player type of the engine asked, or NULL
+    int engineBatch;        // saves per engine request
+    PathQueue queue;
+    pthread_mutex_t outputLock;
+    // engine requests made, moves they asked for and milliseconds they took,
+    // updated under outputLock
+    long engineRequests;
+    long engineMoves;
+    double engineMs;
+} AnalysisJob;
+
+// a worker thread with its own engine, if the job has one
+typedef struct {
+    AnalysisJob* job;
+    Engine* engine;
+} AnalysisWorker;
+
+/* Adds a copy of "path" to the queue, waiting while it is full. */
+static void queue_push(PathQueue* queue, const char* path) {
+    char* copy = strdup(path);
+    pthread_mutex_lock(&queue->lock);
+    while (queue->length == queue->capacity) {
+        pthread_cond_wait(&queue->notFull, &queue->lock);
+    }
+    queue->paths[(queue->start + queue->length++) % queue->capacity] = copy;
+    pthread_cond_signal(&queue->notEmpty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/* Takes the next path off the queue, waiting while it is empty. Returns NULL
+once the queue is empty and finished. The caller frees the path. */
+static char* queue_pop(PathQueue* queue) {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->length == 0 && !queue->finished) {
+        pthread_cond_wait(&queue->notEmpty, &queue->lock);
+    }
+    char* path = NULL;
+    if (queue->length > 0) {
+        path = queue->paths[queue->start];
+        queue->start = (queue->start + 1) % queue->capacity;
+        queue->length--;
+        pthread_cond_signal(&queue->notFull);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return path;
+}
+
+/* Marks the queue finished and wakes every waiting worker. */
+static void queue_finish(PathQueue* queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->finished = 1;
+    pthread_cond_broadcast(&queue->notEmpty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/* Loads the saved game at "path" and analyses its position: whether it is
+already decided, how many placements the next tile has and who wins when
+automated players bots[0] (for *) and bots[1] (for #) play it out, asking
+"cache" (if not NULL) for the positions it has seen before. With
+"keepPosition" set, an undecided position is copied before the play-out and
+kept in the result for the caller to free. */
+void analyse_save(const FitzTiles* tiles, const char* path, int bots[2],
+        FitzCache* cache, Bool keepPosition, Analysis* result) {
+    FitzGame* currentGame;
+    memset(result, 0, sizeof(Analysis));
+    result->error = fitz_game_load(tiles, path, &currentGame);
+    if (result->error != FITZ_OK) {
+        return;
+    }
+    if (cache != NULL) {
+        fitz_game_set_cache(currentGame, cache);
+    }
+    result->rows = fitz_game_rows(currentGame);
+    result->cols = fitz_game_cols(currentGame);
+    result->nextTile = fitz_game_next_tile(currentGame);
+    result->nextPlayer = fitz_game_next_player(currentGame);
+    FitzLegalMap map;
+    int tile = result->nextTile;
+    if (fitz_game_legal_map(currentGame, &tile, 1, FITZ_ALL_ANGLES,
+            &map) == FITZ_OK) {
+        for (int i = 0; i < map.count; i++) {
+            result->legalMoves += fitz_legal_map_count(&map, i);
+        }
+        fitz_legal_map_free(&map);
+    }
+    result->decided = result->legalMoves == 0;
+    if (keepPosition && !result->decided &&
+            fitz_game_copy(currentGame, &result->position) != FITZ_OK) {
+        result->position = NULL;
+    }
+    FitzMove chosen;
+    while (fitz_game_auto_move(currentGame,
+            bots[fitz_game_next_player(currentGame)], &chosen) == FITZ_OK) {
+        result->plies++;
+    }
+    // the player left to move has lost
+    result->winner = 1 - fitz_game_next_player(currentGame);
+    fitz_game_free(currentGame);
+}
+
+/* Writes "text" as a CSV field, quoted if it needs to be. */
+static void write_csv_field(const char* text, FILE* out) {
+    if (strpbrk(text, ",\"\n\r") == NULL) {
+        fputs(text, out);
+        return;
+    }
+    fputc('"', out);
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '"') {
+            fputc('"', out);
+        }
+        fputc(*c, out);
+    }
+    fputc('"', out);
+}
+
+/* Writes the analysis of the save at "path" as one CSV or JSON line, with the
+engine's move if "withEngine" is set. */
+void write_analysis(const char* path, const Analysis* result,
+        OutputFormat format, Bool withEngine, FILE* out) {
+    const char* error = result->error == FITZ_OK ? "" :
+            fitz_error_message(result->error);
+    const char players[] = "*#";
+    if (format == FORMAT_CSV) {
+        write_csv_field(path, out);
+        fputc(',', out);
+        write_csv_field(error, out);
+        if (result->error == FITZ_OK) {
+            fprintf(out, ",%d,%d,%d,%c,%d,%ld,%c,%ld", result->rows,
+                    result->cols, result->nextTile,
+                    players[result->nextPlayer], result->decided,
+                    result->legalMoves, players[result->winner],
+                    result->plies);
+        } else {
+            fputs(",,,,,,,,", out);
+        }
+        if (withEngine && result->engineMoved) {
+            fprintf(out, ",%d %d %d,%d", result->engineMove.row,
+                    result->engineMove.col, result->engineMove.angle,
+                    result->engineLegal);
+        } else if (withEngine) {
+            fputs(",,", out);
+        }
+        fputc('\n', out);
+        return;
+    }
+    fputs("{\"path\":", out);
+    write_json_string(path, out);
+    if (result->error != FITZ_OK) {
+        fputs(",\"error\":", out);
+        write_json_string(error, out);
+        fputs("}\n", out);
+        return;
+    }
+    fprintf(out, ",\"rows\":%d,\"cols\":%d,\"next_tile\":%d,"
+            "\"next_player\":\"%c\",\"decided\":%s,\"legal_moves\":%ld,"
+            "\"winner\":\"%c\",\"plies\":%ld", result->rows, result->cols,
+            result->nextTile, players[result->nextPlayer],
+            result->decided ? "true" : "false", result->legalMoves,
+            players[result->winner], result->plies);
+    if (withEngine && result->engineMoved) {
+        fprintf(out, ",\"engine_move\":\"%d %d %d\",\"engine_legal\":%s",
+                result->engineMove.row, result->engineMove.col,
+                result->engineMove.angle,
+                result->engineLegal ? "true" : "false");
+    }
+    fputs("}\n", out);
+}
+
+/* Asks a worker's engine for its move in each of the "count" analysed
+positions that can still be played (those kept in "results"), with one
+request, and records the moves and whether they are legal. The kept
+positions are freed. An engine that fails is reported and stopped, and isn't
+asked again. */
+static void ask_engine(AnalysisWorker* worker, Analysis* results, int count) {
+    AnalysisJob* job = worker->job;
+    FitzGame** positions = malloc(sizeof(FitzGame*) * count);
+    int* owners = malloc(sizeof(int) * count);
+    FitzMove* moves = malloc(sizeof(FitzMove) * count);
+    int asked = 0;
+    for (int i = 0; i < count; i++) {
+        if (results[i].position != NULL) {
+            positions[asked] = results[i].position;
+            owners[asked++] = i;
+            results[i].position = NULL;
+        }
+    }
+    if (asked > 0) {
+        double start = fitz_now_millis();
+        EngineStatus status = engine_request_moves(worker->engine, positions,
+                asked, moves);
+        double elapsed = fitz_now_millis() - start;
+        for (int j = 0; j < asked; j++) {
+            Analysis* result = &results[owners[j]];
+            if (status == ENGINE_OK) {
+                result->engineMoved = 1;
+                result->engineMove = moves[j];
+                result->engineLegal =
+                        fitz_game_play(positions[j], moves[j]) == FITZ_OK;
+            }
+            fitz_game_free(positions[j]);
+        }
+        pthread_mutex_lock(&job->outputLock);
+        if (status == ENGINE_OK) {
+            job->engineRequests++;
+            job->engineMoves += asked;
+            job->engineMs += elapsed;
+        } else {
+            fprintf(stderr, "Engine %s\n", engine_status_message(status));
+        }
+        pthread_mutex_unlock(&job->outputLock);
+        if (status != ENGINE_OK) {
+            engine_stop(worker->engine);
+            worker->engine = NULL;
+        }
+    }
+    free(moves);
+    free(owners);
+    free(positions);
+}
+
+/* Analyses saves off the job's queue until it runs dry, writing each result
+as soon as it is ready. With an engine the saves are taken "engineBatch" at a
+time, and the engine is asked for its moves in all of them at once. */
+static void* analysis_worker(void* arg) {
+    AnalysisWorker* worker = arg;
+    AnalysisJob* job = worker->job;
+    char** paths = malloc(sizeof(char*) * job->engineBatch);
+    Analysis* results = malloc(sizeof(Analysis) * job->engineBatch);
+    while (1) {
+        int count = 0;
+        while (count < job->engineBatch &&
+                (paths[count] = queue_pop(&job->queue)) != NULL) {
+            analyse_save(job->tiles, paths[count], job->bots, job->cache,
+                    worker->engine != NULL, &results[count]);
+            count++;
+        }
+        if (count == 0) {
+            break;
+        }
+        if (worker->engine != NULL) {
+            ask_engine(worker, results, count);
+        }
+        pthread_mutex_lock(&job->outputLock);
+        for (int i = 0; i < count; i++) {
+            write_analysis(paths[i], &results[i], job->format,
+                    job->engineType != NULL, stdout);
+            free(paths[i]);
+        }
+        fflush(stdout);
+        pthread_mutex_unlock(&job->outputLock);
+    }
+    free(results);
+    free(paths);
+    return NULL;
+}
+
+/* Queues the save files named by "source": the files in it if it is a
+directory, the paths on standard input (one per line) if it is "-", or else
+the file itself. */
+static void queue_source(PathQueue* queue, const char* source) {
+    struct stat info;
+    if (strcmp(source, "-") == 0) {
+        char line[ANALYSE_PATH_LENGTH];
+        while (fgets(line, sizeof(line), stdin) != NULL) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0] != '\0') {
+                queue_push(queue, line);
+            }
+        }
+        return;
+    }
+    if (stat(source, &info) == -1 || !S_ISDIR(info.st_mode)) {
+        queue_push(queue, source);
+        return;
+    }
+    DIR* directory = opendir(source);
+    if (directory == NULL) {
+        queue_push(queue, source);
+        return;
+    }
+    struct dirent* entry;
+    char path[ANALYSE_PATH_LENGTH];
+    while ((entry = readdir(directory)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", source, entry->d_name);
+        if (stat(path, &info) == 0 && S_ISREG(info.st_mode)) {
+            queue_push(queue, path);
+        }
+    }
+    closedir(directory);
+}
+
+/* Prints the usage message of "fitz --analyse" and returns its status. */
+static int analysis_usage(void) {
+    fprintf(stderr, "Usage: fitz --analyse [-j threads] [--jsonl] "
+            "[--bots AB] [--cache FILE] [--engine TYPE] [--engine-batch N] "
+            "tilefile source ...\n");
+    return 1;
+}
+
+/* Runs "fitz --analyse [-j threads] [--jsonl] [--bots AB] [--cache FILE]
+[--engine TYPE] [--engine-batch N] tilefile source ...": analyses every saved
+game named by the sources (directories, save files, or "-" for a list of paths
+on standard input) on all processors, and streams one CSV line (after a
+header) or JSON line per save, in the order they finish. The games are played
+out by automated players A and B (1 or 2; by default 1 and 2), sharing the
+position cache FILE if one is given. With an engine player type, every thread
+runs its own engine and asks it for its moves N saves at a time; the engine's
+throughput goes to standard error. Returns the program's exit status. */
+int run_analysis(char** args, int argCount) {
+    long threadCount = sysconf(_SC_NPROCESSORS_ONLN);
+    long engineBatch = ANALYSE_DEFAULT_ENGINE_BATCH;
+    AnalysisJob job;
+    job.bots[0] = 1;
+    job.bots[1] = 2;
+    job.format = FORMAT_CSV;
+    job.cache = NULL;
+    job.engineType = NULL;
+    job.engineRequests = 0;
+    job.engineMoves = 0;
+    job.engineMs = 0;
+    char* cachePath = NULL;
+    int used = 0;
+    while (used < argCount && args[used][0] == '-') {
+        if (strcmp(args[used], "--jsonl") == 0) {
+            job.format = FORMAT_JSONL;
+            used++;
+        } else if (used + 1 < argCount && strcmp(args[used], "-j") == 0) {
+            if (!parse_count(args[used + 1], 1, 1024, &threadCount)) {
+                return analysis_usage();
+            }
+            used += 2;
+        } else if (used + 1 < argCount && strcmp(args[used], "--bots") == 0 &&
+                strlen(args[used + 1]) == 2 &&
+                strspn(args[used + 1], "12") == 2) {
+            job.bots[0] = args[used + 1][0] - '0';
+            job.bots[1] = args[used + 1][1] - '0';
+            used += 2;
+        } else if (used + 1 < argCount && strcmp(args[used], "--cache") == 0) {
+            cachePath = args[used + 1];
+            used += 2;
+        } else if (used + 1 < argCount &&
+                strcmp(args[used], "--engine") == 0 &&
+                is_engine_type(args[used + 1])) {
+            job.engineType = args[used + 1];
+            used += 2;
+        } else if (used + 1 < argCount &&
+                strcmp(args[used], "--engine-batch") == 0) {
+            if (!parse_count(args[used + 1], 1, 4096, &engineBatch)) {
+                return analysis_usage();
+            }
+            used += 2;
+        } else {
+            return analysis_usage();
+        }
+    }
+    if (argCount - used < 2 || threadCount < 1) {
+        return analysis_usage();
+    }
+    FitzTiles* tiles = load_tiles(args[used]);
+    job.tiles = tiles;
+    if (cachePath != NULL) {
+        FitzError error = fitz_cache_open(cachePath, &job.cache);
+        if (error != FITZ_OK) {
+            exit_with_error(error);
+        }
+    }
+    // without an engine the saves are taken one at a time
+    job.engineBatch = job.engineType == NULL ? 1 : (int)engineBatch;
+    AnalysisWorker* workers = malloc(sizeof(AnalysisWorker) * threadCount);
+    for (int i = 0; i < threadCount; i++) {
+        workers[i].job = &job;
+        workers[i].engine = NULL;
+        if (job.engineType != NULL && engine_start(job.engineType, tiles,
+                &workers[i].engine) != ENGINE_OK) {
+            fprintf(stderr, "Can't start engine\n");
+            exit(12);
+        }
+    }
+    PathQueue* queue = &job.queue;
+    queue->capacity = ANALYSE_QUEUE_PER_THREAD * threadCount;
+    queue->paths = malloc(sizeof(char*) * queue->capacity);
+    queue->start = 0;
+    queue->length = 0;
+    queue->finished = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->notEmpty, NULL);
+    pthread_cond_init(&queue->notFull, NULL);
+    pthread_mutex_init(&job.outputLock, NULL);
+    if (job.format == FORMAT_CSV) {
+        printf("path,error,rows,cols,next_tile,next_player,decided,"
+                "legal_moves,winner,plies%s\n", job.engineType == NULL ? "" :
+                ",engine_move,engine_legal");
+        fflush(stdout);
+    }
+
+    pthread_t* threads = malloc(sizeof(pthread_t) * threadCount);
+    for (int i = 0; i < threadCount; i++) {
+        pthread_create(&threads[i], NULL, analysis_worker, &workers[i]);
+    }
+    for (int i = used + 1; i < argCount; i++) {
+        queue_source(queue, args[i]);
+    }
+    queue_finish(queue);
+    for (int i = 0; i < threadCount; i++) {
+        pthread_join(threads[i], NULL);
+        if (workers[i].engine != NULL) {
+            engine_stop(workers[i].engine);
+        }
+    }
+    if (job.engineType != NULL) {
+        double seconds = job.engineMs / 1000;
+        fprintf(stderr, "Engine: %ld moves in %ld requests, %.3f s "
+                "(%.0f moves/s)\n", job.engineMoves, job.engineRequests,
+                seconds, seconds > 0 ? job.engineMoves / seconds : 0.0);
+    }
+
+    free(workers);
+    free(threads);
+    pthread_mutex_destroy(&job.outputLock);
+    pthread_cond_destroy(&queue->notFull);
+    pthread_cond_destroy(&queue->notEmpty);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->paths);
+    if (job.cache != NULL) {
+        fitz_cache_free(job.cache);
+    }
+    fitz_tiles_free(tiles);
+    return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef ANALYSE_H
+#define ANALYSE_H
+
+#include "head.h"
+
+// save files waiting for a worker, per thread; this bounds the memory used
+// however many files are analysed
+#define ANALYSE_QUEUE_PER_THREAD 4
+// longest save file path analysed
+#define ANALYSE_PATH_LENGTH 4096
+// saves whose positions are sent to an engine in one request, unless
+// "--engine-batch" says otherwise
+#define ANALYSE_DEFAULT_ENGINE_BATCH 64
+
+// how results are written
+typedef enum {
+    FORMAT_CSV,
+    FORMAT_JSONL
+} OutputFormat;
+
+// what the analysis found out about one saved game
+typedef struct {
+    FitzError error;        // FITZ_OK if the save loaded
+    int rows;
+    int cols;
+    int nextTile;
+    int nextPlayer;
+    Bool decided;           // the player to move can't place their tile
+    long legalMoves;        // placements of the next tile
+    int winner;             // 0 for *, 1 for #, after the bots played on
+    long plies;             // moves the bots made to finish the game
+    Bool engineMoved;       // the engine was asked for a move and gave one
+    FitzMove engineMove;
+    Bool engineLegal;       // the engine's move was legal
+    // a copy of the loaded position for the engine, if it was asked to keep
+    // one and the position isn't decided; otherwise NULL
+    FitzGame* position;
+} Analysis;
+
+//function prototypes
+int run_analysis(char** args, int argCount);
+void analyse_save(const FitzTiles* tiles, const char* path, int bots[2],
+        FitzCache* cache, Bool keepPosition, Analysis* result);
+void write_analysis(const char* path, const Analysis* result,
+        OutputFormat format, Bool withEngine, FILE* out);
+
+#endif
@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "autosave.h"
+#include "timing.h"
+
+/* With "--autosave FILE", a game is saved to FILE every so many moves and
+every so many milliseconds, in the save file format of fitz_game_save(), by a
+writer thread, so that the game never waits for the disk. The game thread only
+copies the board into one of two snapshots; the writer writes the other one
+out. A newer snapshot replaces one the writer hasn't started on yet. Each save
+is written to a temporary file, flushed to the disk and then renamed over FILE,
+so that after a crash FILE holds either the previous save or the new one,
+never part of one. */
+
+// a position as a save file holds it
+typedef struct {
+    char* grid;
+    int nextTile;
+    int nextPlayer;
+} Snapshot;
+
+struct Autosaver {
+    char* path;
+    char* tempPath;         // written first, then renamed to "path"
+    int rows;
+    int cols;
+    long gridLength;        // bytes of the board, newlines included
+    int everyMoves;
+    int everyMs;
+    long movesSince;        // moves made since the last snapshot
+    double lastSnapshot;    // when it was taken
+    Snapshot snapshots[2];
+    // the snapshot waiting to be written and the one being written, or -1
+    int pending;
+    int writing;
+    Bool finished;          // no more snapshots are coming
+    Bool failed;            // a save has failed and been reported
+    pthread_mutex_t lock;
+    pthread_cond_t ready;   // a snapshot is pending or the game has finished
+    pthread_t thread;
+};
+
+/* Writes all "length" bytes of "data" to "fd". Returns 0 if that fails,
+otherwise 1. */
+static Bool write_all(int fd, const char* data, long length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        data += written;
+        length -= written;
+    }
+    return 1;
+}
+
+/* Flushes the directory holding "path" to the disk, so that a rename into it
+survives a crash. */
+static void sync_directory(const char* path) {
+    const char* slash = strrchr(path, '/');
+    char* directory = strdup(slash == NULL ? "." : path);
+    if (slash != NULL) {
+        // the root keeps its slash
+        directory[slash == path ? 1 : slash - path] = '\0';
+    }
+    int fd = open(directory, O_RDONLY);
+    if (fd != -1) {
+        fsync(fd);
+        close(fd);
+    }
+    free(directory);
+}
+
+/* Saves a snapshot: writes it to the temporary file, flushes that to the disk
+and renames it over the save file. Returns 0 if any of that fails, otherwise
+1. */
+static Bool write_snapshot(Autosaver* autosaver, const Snapshot* snapshot) {
+    int fd = open(autosaver->tempPath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd == -1) {
+        return 0;
+    }
+    char header[64];
+    int length = sprintf(header, "%d %d %d %d\n", snapshot->nextTile,
+            snapshot->nextPlayer, autosaver->rows, autosaver->cols);
+    Bool written = write_all(fd, header, length) &&
+            write_all(fd, snapshot->grid, autosaver->gridLength) &&
+            fsync(fd) == 0;
+    if (close(fd) == -1 || !written ||
+            rename(autosaver->tempPath, autosaver->path) == -1) {
+        unlink(autosaver->tempPath);
+        return 0;
+    }
+    sync_directory(autosaver->path);
+    return 1;
+}
+
+/* The writer thread: writes out each snapshot as it becomes pending, until
+the game has finished and nothing is pending. The lock is never held while
+writing. */
+static void* write_snapshots(void* arg) {
+    Autosaver* autosaver = arg;
+    pthread_mutex_lock(&autosaver->lock);
+    while (1) {
+        while (autosaver->pending == -1 && !autosaver->finished) {
+            pthread_cond_wait(&autosaver->ready, &autosaver->lock);
+        }
+        if (autosaver->pending == -1) {
+            break;
+        }
+        int writing = autosaver->pending;
+        autosaver->writing = writing;
+        autosaver->pending = -1;
+        pthread_mutex_unlock(&autosaver->lock);
+        if (!write_snapshot(autosaver, &autosaver->snapshots[writing]) &&
+                !autosaver->failed) {
+            fprintf(stderr, "Unable to autosave game\n");
+            autosaver->failed = 1;
+        }
+        pthread_mutex_lock(&autosaver->lock);
+        autosaver->writing = -1;
+    }
+    pthread_mutex_unlock(&autosaver->lock);
+    return NULL;
+}
+
+/* Starts a writer thread saving a game to the "--autosave" file every
+"--autosave-moves" moves and every "--autosave-ms" milliseconds. */
+Autosaver* autosave_start(const FitzGame* currentGame, Options* options) {
+    Autosaver* autosaver = malloc(sizeof(Autosaver));
+    autosaver->path = options->autosavePath;
+    autosaver->tempPath = malloc(strlen(autosaver->path) +
+            strlen(AUTOSAVE_TEMP_SUFFIX) + 1);
+    sprintf(autosaver->tempPath, "%s%s", autosaver->path,
+            AUTOSAVE_TEMP_SUFFIX);
+    autosaver->rows = fitz_game_rows(currentGame);
+    autosaver->cols = fitz_game_cols(currentGame);
+    autosaver->gridLength = (long)autosaver->rows * (autosaver->cols + 1);
+    autosaver->everyMoves = options->autosaveMoves;
+    autosaver->everyMs = options->autosaveMs;
+    autosaver->movesSince = 0;
+    autosaver->lastSnapshot = fitz_now_millis();
+    for (int i = 0; i < 2; i++) {
+        autosaver->snapshots[i].grid = malloc(autosaver->gridLength);
+    }
+    autosaver->pending = -1;
+    autosaver->writing = -1;
+    autosaver->finished = 0;
+    autosaver->failed = 0;
+    pthread_mutex_init(&autosaver->lock, NULL);
+    pthread_cond_init(&autosaver->ready, NULL);
+    pthread_create(&autosaver->thread, NULL, write_snapshots, autosaver);
+    return autosaver;
+}
+
+/* Copies a game's position into the snapshot the writer isn't writing and
+hands it to the writer. */
+static void take_snapshot(Autosaver* autosaver,
+        const FitzGame* currentGame) {
+    pthread_mutex_lock(&autosaver->lock);
+    int spare = autosaver->writing == 0 ? 1 : 0;
+    Snapshot* snapshot = &autosaver->snapshots[spare];
+    memcpy(snapshot->grid, fitz_game_grid(currentGame),
+            autosaver->gridLength);
+    snapshot->nextTile = fitz_game_next_tile(currentGame);
+    snapshot->nextPlayer = fitz_game_next_player(currentGame);
+    autosaver->pending = spare;
+    pthread_cond_signal(&autosaver->ready);
+    pthread_mutex_unlock(&autosaver->lock);
+    autosaver->movesSince = 0;
+    autosaver->lastSnapshot = fitz_now_millis();
+}
+
+/* Notes that a move has been made, and snapshots the game if enough moves or
+time have gone by since the last snapshot. */
+void autosave_move(Autosaver* autosaver, const FitzGame* currentGame) {
+    autosaver->movesSince++;
+    if (autosaver->movesSince >= autosaver->everyMoves ||
+            fitz_now_millis() - autosaver->lastSnapshot >= autosaver->everyMs) {
+        take_snapshot(autosaver, currentGame);
+    }
+}
+
+/* Snapshots the game's final position if it hasn't been yet, waits for the
+writer to save it and frees the writer. */
+void autosave_finish(Autosaver* autosaver, const FitzGame* currentGame) {
+    if (autosaver->movesSince > 0) {
+        take_snapshot(autosaver, currentGame);
+    }
+    pthread_mutex_lock(&autosaver->lock);
+    autosaver->finished = 1;
+    pthread_cond_signal(&autosaver->ready);
+    pthread_mutex_unlock(&autosaver->lock);
+    pthread_join(autosaver->thread, NULL);
+    pthread_cond_destroy(&autosaver->ready);
+    pthread_mutex_destroy(&autosaver->lock);
+    for (int i = 0; i < 2; i++) {
+        free(autosaver->snapshots[i].grid);
+    }
+    free(autosaver->tempPath);
+    free(autosaver);
+}
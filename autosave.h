@@ -0,0 +1,21 @@
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include "head.h"
+
+// moves between autosaves unless "--autosave-moves" says otherwise
+#define AUTOSAVE_DEFAULT_MOVES 100
+// longest wait for an autosave unless "--autosave-ms" says otherwise
+#define AUTOSAVE_DEFAULT_MS 10000
+// added to the save file's path to name the file an autosave is written to
+#define AUTOSAVE_TEMP_SUFFIX ".tmp"
+
+// a writer thread saving snapshots of a game (see autosave.c)
+typedef struct Autosaver Autosaver;
+
+//function prototypes
+Autosaver* autosave_start(const FitzGame* currentGame, Options* options);
+void autosave_move(Autosaver* autosaver, const FitzGame* currentGame);
+void autosave_finish(Autosaver* autosaver, const FitzGame* currentGame);
+
+#endif
@@ -0,0 +1,458 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "internal.h"
+
+/* A batch engine plays many games on small boards at once, in lockstep: each
+step makes one move in every game still running, and a finished game's lane
+is refilled with the next game. The games are played as fitz --export plays
+them: random legal moves first, then automated players 1 and 2, with the same
+choices as a FitzGame would make.
+
+State is kept as structure of arrays. A board row fits in one word, so the
+free cells of padded row y of every lane's board lie side by side at
+free[y * lanes + lane]. Each step the running lanes' rows are copied side by
+side in order of the tile the lane places next, so that the lanes placing the
+same tile are contiguous, and the legal anchors of every lane's next tile are
+worked out in one kernel over each such range: the tile's markers are the outer
+loops and the lanes the inner one, a plain shift-and-mask over consecutive
+words, so one pass over the board's rows serves every such game at once.
+Random moves are drawn from those anchors. The automated players' scans for
+their first anchor read them too, in rounds of one anchor row each, with the
+lanes dropping out as they find theirs. Cell (r, c) is bit
+c + margin + centre of padded row r + FREE_BORDER, and anchor (r, c) is bit
+c + margin of anchor row r + margin, where the centre is the tile's centre
+row and column, (size - 1) / 2. */
+
+// increment of the splitmix64 sequence the lanes draw random moves from
+#define BATCH_GAMMA 0x9e3779b97f4a7c15ULL
+// spacing of the games' random sequences, as in fitz --export
+#define BATCH_GAME_SPACING 0xd1b54a32d192ed03ULL
+
+struct FitzBatch {
+    const FitzTiles* library;
+    int rows;
+    int cols;
+    int lanes;
+    int margin;
+    int centre;
+    int height;             // padded rows of a board
+    int anchorRows;         // rows + 2 * margin
+    uint64_t domain;        // the anchor bits of an anchor row
+    int bots[2];
+    int randomPlies;
+    uint64_t seed;
+    long nextGame;          // number of the next game to start
+    long gamesLeft;         // games of the current run not started yet
+    uint64_t* emptyBoard;   // a new board's padded rows
+    uint64_t* free;         // free[y * lanes + lane]
+    // grouped[y * lanes + i]: free[y * lanes + byTile[i]], so each tile's
+    // lanes are contiguous
+    uint64_t* grouped;
+    // legal[(angle / 90 * anchorRows + y) * lanes + i]: the legal anchors of
+    // the next tile of lane byTile[i]
+    uint64_t* legal;
+    Bool* running;          // the lane is playing a game
+    int* ply;               // moves made in the lane's game
+    int* recent;            // per lane the last anchor (row and column) of *,
+                            // of # and of either, as in recentPlays
+    uint64_t* random;       // state of the lane's random sequence
+    int* byTile;            // running lanes, by next tile
+    int* tileStart;         // tile t's lanes are byTile[tileStart[t]...]
+    int* grouping;          // per running lane its index in byTile
+    // the automated players' scans for their anchors (see scan_lanes())
+    int* scanning;          // lanes still scanning
+    int* scanStart;         // per lane the anchor row and column it started at
+    int* scanRow;           // anchor row the lane probes next
+    int* scanStep;          // rows probed since the scan (re)started
+    int* scanAngles;        // rotations scanned for, as FITZ_ANGLE_BIT values
+    int* scanDirection;     // 1 forwards or -1 backwards
+    FitzMove* chosen;       // each lane's move this step
+    Bool* moved;            // the lane has a move this step
+};
+
+/* Starts the next game of the run in "lane", or leaves it idle if none is
+left. */
+static void start_lane(FitzBatch* batch, int lane) {
+    if (batch->gamesLeft == 0) {
+        batch->running[lane] = 0;
+        return;
+    }
+    batch->gamesLeft--;
+    for (int y = 0; y < batch->height; y++) {
+        batch->free[y * batch->lanes + lane] = batch->emptyBoard[y];
+    }
+    batch->running[lane] = 1;
+    batch->ply[lane] = 0;
+    for (int i = 0; i < 6; i++) {
+        batch->recent[lane * 6 + i] = -10;
+    }
+    batch->random[lane] = batch->seed +
+            (uint64_t)batch->nextGame++ * BATCH_GAME_SPACING;
+}
+
+/* Makes a batch engine of "lanes" lanes for games of "tiles" on rows x cols
+boards. Each game opens with "randomPlies" random legal moves, drawn from a
+sequence given by "seed" and the game's number, and is then played out by
+automated players bots[0] (for *) and bots[1] (for #), 1 or 2. A board row
+and its margins must fit in a word. */
+FitzError fitz_batch_new(const FitzTiles* tiles, int rows, int cols,
+        int lanes, const int bots[2], int randomPlies, uint64_t seed,
+        FitzBatch** batchPtr) {
+    if (rows < 1 || cols < 1 || rows > FITZ_MAX_DIMENSION ||
+            cols + 2 * tiles->margin + tiles->size - 2 >= 64) {
+        return FITZ_ERR_DIMENSIONS;
+    }
+    if (lanes < 1 || randomPlies < 0 || bots[0] < 1 || bots[0] > 2 ||
+            bots[1] < 1 || bots[1] > 2) {
+        return FITZ_ERR_ARGUMENT;
+    }
+    FitzBatch* batch = malloc(sizeof(FitzBatch));
+    batch->library = tiles;
+    batch->rows = rows;
+    batch->cols = cols;
+    batch->lanes = lanes;
+    batch->margin = tiles->margin;
+    batch->centre = (tiles->size - 1) / 2;
+    batch->height = rows + 2 * FREE_BORDER;
+    batch->anchorRows = rows + 2 * batch->margin;
+    batch->domain = ((uint64_t)1 << (cols + 2 * batch->margin)) - 1;
+    batch->bots[0] = bots[0];
+    batch->bots[1] = bots[1];
+    batch->randomPlies = randomPlies;
+    batch->seed = seed;
+    batch->nextGame = 0;
+    batch->gamesLeft = 0;
+    batch->emptyBoard = calloc(batch->height, sizeof(uint64_t));
+    for (int r = 0; r < rows; r++) {
+        batch->emptyBoard[r + FREE_BORDER] = (((uint64_t)1 << cols) - 1) <<
+                (batch->margin + batch->centre);
+    }
+    batch->free = malloc(sizeof(uint64_t) * batch->height * lanes);
+    batch->grouped = malloc(sizeof(uint64_t) * batch->height * lanes);
+    batch->legal = malloc(sizeof(uint64_t) * 4 * batch->anchorRows * lanes);
+    batch->running = calloc(lanes, sizeof(Bool));
+    batch->ply = malloc(sizeof(int) * lanes);
+    batch->recent = malloc(sizeof(int) * 6 * lanes);
+    batch->random = malloc(sizeof(uint64_t) * lanes);
+    batch->byTile = malloc(sizeof(int) * lanes);
+    batch->tileStart = malloc(sizeof(int) * (tiles->tilesCount + 1));
+    batch->grouping = malloc(sizeof(int) * lanes);
+    batch->scanning = malloc(sizeof(int) * lanes);
+    batch->scanStart = malloc(sizeof(int) * 2 * lanes);
+    batch->scanRow = malloc(sizeof(int) * lanes);
+    batch->scanStep = malloc(sizeof(int) * lanes);
+    batch->scanAngles = malloc(sizeof(int) * lanes);
+    batch->scanDirection = malloc(sizeof(int) * lanes);
+    batch->chosen = malloc(sizeof(FitzMove) * lanes);
+    batch->moved = malloc(sizeof(Bool) * lanes);
+    *batchPtr = batch;
+    return FITZ_OK;
+}
+
+/* Frees a batch engine. Its tile library is left alone. */
+void fitz_batch_free(FitzBatch* batch) {
+    free(batch->emptyBoard);
+    free(batch->free);
+    free(batch->grouped);
+    free(batch->legal);
+    free(batch->running);
+    free(batch->ply);
+    free(batch->recent);
+    free(batch->random);
+    free(batch->byTile);
+    free(batch->tileStart);
+    free(batch->grouping);
+    free(batch->scanning);
+    free(batch->scanStart);
+    free(batch->scanRow);
+    free(batch->scanStep);
+    free(batch->scanAngles);
+    free(batch->scanDirection);
+    free(batch->chosen);
+    free(batch->moved);
+    free(batch);
+}
+
+/* Groups the running lanes by the tile they place next, and copies their rows
+to batch->grouped in that order. */
+static void group_lanes(FitzBatch* batch) {
+    int tilesCount = batch->library->tilesCount;
+    memset(batch->tileStart, 0, sizeof(int) * (tilesCount + 1));
+    for (int lane = 0; lane < batch->lanes; lane++) {
+        if (batch->running[lane]) {
+            batch->tileStart[batch->ply[lane] % tilesCount]++;
+        }
+    }
+    // each tile's entry now counts to the end of its group, and the last one
+    // counts every lane
+    for (int t = 1; t <= tilesCount; t++) {
+        batch->tileStart[t] += batch->tileStart[t - 1];
+    }
+    // fill each group from its end, so that tileStart ends up at its start
+    for (int lane = batch->lanes - 1; lane >= 0; lane--) {
+        if (batch->running[lane]) {
+            int t = batch->ply[lane] % tilesCount;
+            batch->grouping[lane] = --batch->tileStart[t];
+            batch->byTile[batch->grouping[lane]] = lane;
+        }
+    }
+    long width = batch->lanes;
+    int count = batch->tileStart[tilesCount];
+    for (int y = 0; y < batch->height; y++) {
+        const uint64_t* cells = batch->free + y * width;
+        uint64_t* grouped = batch->grouped + y * width;
+        for (int i = 0; i < count; i++) {
+            grouped[i] = cells[batch->byTile[i]];
+        }
+    }
+}
+
+/* Works out the legal anchors of tile "t" in every rotation for the "count"
+grouped lanes from byTile[first] on. */
+static void legal_anchors(FitzBatch* batch, int t, int first, int count) {
+    long width = batch->lanes;
+    uint64_t domain = batch->domain;
+    for (int a = 0; a < 4; a++) {
+        const TileShape* shape = &batch->library->shapes[t * 4 + a];
+        uint64_t* legal = batch->legal + a * batch->anchorRows * width +
+                first;
+        // anchor rows outside these put a marker off the board
+        int top = shape->count > 0 ? batch->margin - shape->minDy : 0;
+        int bottom = shape->count > 0 ? batch->rows + batch->margin -
+                shape->maxDy : batch->anchorRows;
+        for (int y = 0; y < batch->anchorRows; y++) {
+            uint64_t* restrict row = legal + y * width;
+            if (y < top || y >= bottom) {
+                memset(row, 0, sizeof(uint64_t) * count);
+                continue;
+            }
+            for (int i = 0; i < count; i++) {
+                row[i] = domain;
+            }
+            for (int m = 0; m < shape->count; m++) {
+                // the marker of anchor bit x covers bit x + dx + centre of
+                // its padded row
+                const uint64_t* restrict cells = batch->grouped + (y -
+                        batch->margin + shape->dy[m] + FREE_BORDER) * width +
+                        first;
+                int shift = shape->dx[m] + batch->centre;
+                for (int i = 0; i < count; i++) {
+                    row[i] &= cells[i] >> shift;
+                }
+            }
+        }
+    }
+}
+
+/* Returns the legal anchors in anchor row "y" of a lane's next tile in any of
+the rotations in "angles" (a set of FITZ_ANGLE_BIT values). */
+static uint64_t probe_angles(const FitzBatch* batch, int lane, int angles,
+        int y) {
+    long width = batch->lanes;
+    const uint64_t* legal = batch->legal + y * width +
+            batch->grouping[lane];
+    uint64_t bits = 0;
+    for (int a = 0; a < 4; a++) {
+        if (angles & (1 << a)) {
+            bits |= legal[a * batch->anchorRows * width];
+        }
+    }
+    return bits;
+}
+
+/* Sets up the scan of automated player 1 or 2 in a lane as automated_move_1()
+or automated_move_2() would start it: player 1 scans forwards from the last
+move for one rotation at a time, and player 2 from its own last move for any
+rotation, forwards for * and backwards for #. */
+static void start_scan(FitzBatch* batch, int lane) {
+    int player = batch->ply[lane] % 2;
+    const int* recent = batch->recent + lane * 6;
+    int margin = batch->margin;
+    int* start = batch->scanStart + lane * 2;
+    if (batch->bots[player] == 1) {
+        start[0] = recent[4] == -10 ? -margin : recent[4];
+        start[1] = recent[4] == -10 ? -margin : recent[5];
+        batch->scanAngles[lane] = FITZ_ANGLE_BIT(0);
+        batch->scanDirection[lane] = 1;
+    } else {
+        start[0] = recent[player * 2];
+        start[1] = recent[player * 2 + 1];
+        if (start[0] == -10) {
+            start[0] = player == 0 ? -margin : batch->rows + margin - 1;
+            start[1] = player == 0 ? -margin : batch->cols + margin - 1;
+        }
+        batch->scanAngles[lane] = FITZ_ALL_ANGLES;
+        batch->scanDirection[lane] = player == 0 ? 1 : -1;
+    }
+    batch->scanRow[lane] = start[0] + margin;
+    batch->scanStep[lane] = 0;
+}
+
+/* Ends a lane's scan at the lowest bit (scanning forwards) or highest bit
+(backwards) of "bits", in the smallest rotation of the scan that fits
+there. */
+static void end_scan(FitzBatch* batch, int lane, uint64_t bits) {
+    int y = batch->scanRow[lane];
+    int x = batch->scanDirection[lane] > 0 ? __builtin_ctzll(bits) :
+            63 - __builtin_clzll(bits);
+    FitzMove* move = &batch->chosen[lane];
+    move->row = y - batch->margin;
+    move->col = x - batch->margin;
+    for (int a = 0; a < 4; a++) {
+        if ((batch->scanAngles[lane] & (1 << a)) &&
+                ((probe_angles(batch, lane, 1 << a, y) >> x) & 1)) {
+            move->angle = a * 90;
+            break;
+        }
+    }
+    batch->moved[lane] = 1;
+}
+
+/* Runs the scans of the "count" lanes at batch->scanning in lockstep as
+first_legal_anchor() runs one: each round probes the next anchor row of every
+lane still scanning, wrapping around the anchor domain and ending just before
+its start, where the start row is probed twice. A lane of automated player 1
+that finds nothing starts again in the next rotation. */
+static void scan_lanes(FitzBatch* batch, int count) {
+    int height = batch->anchorRows;
+    int* scanning = batch->scanning;
+    while (count > 0) {
+        int left = 0;
+        for (int i = 0; i < count; i++) {
+            int lane = scanning[i];
+            int step = batch->scanStep[lane];
+            int direction = batch->scanDirection[lane];
+            int x = batch->scanStart[lane * 2 + 1] + batch->margin;
+            uint64_t bits = probe_angles(batch, lane, batch->scanAngles[lane],
+                    batch->scanRow[lane]);
+            // the start row from the start on, and at the end up to it
+            if (step == 0) {
+                bits &= direction > 0 ? ~(uint64_t)0 << x :
+                        ~(~(uint64_t)1 << x);
+            } else if (step == height) {
+                bits &= direction > 0 ? ~(~(uint64_t)0 << x) :
+                        ~(uint64_t)1 << x;
+            }
+            if (bits != 0) {
+                end_scan(batch, lane, bits);
+                continue;
+            }
+            if (step < height) {
+                batch->scanRow[lane] = (batch->scanRow[lane] + direction +
+                        height) % height;
+                batch->scanStep[lane]++;
+            } else if (batch->scanAngles[lane] < FITZ_ANGLE_BIT(270)) {
+                batch->scanAngles[lane] <<= 1;
+                batch->scanRow[lane] = batch->scanStart[lane * 2] +
+                        batch->margin;
+                batch->scanStep[lane] = 0;
+            } else {
+                batch->moved[lane] = 0;
+                continue;
+            }
+            scanning[left++] = lane;
+        }
+        count = left;
+    }
+}
+
+/* Chooses the k-th legal placement of the next tile of grouped lane "i", in
+order of angle, row and column, as a random move. Returns 0 if there is none,
+otherwise 1. */
+static Bool random_move(FitzBatch* batch, int i, FitzMove* move) {
+    int lane = batch->byTile[i];
+    const uint64_t* legal = batch->legal + i;
+    long total = 0;
+    long words = 4L * batch->anchorRows;
+    for (long w = 0; w < words; w++) {
+        total += __builtin_popcountll(legal[w * batch->lanes]);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t draw = mix_bits(batch->random[lane]);
+    batch->random[lane] += BATCH_GAMMA;
+    long k = (long)(draw % (uint64_t)total);
+    for (long w = 0; ; w++) {
+        uint64_t bits = legal[w * batch->lanes];
+        int count = __builtin_popcountll(bits);
+        if (k >= count) {
+            k -= count;
+            continue;
+        }
+        while (k-- > 0) {
+            bits &= bits - 1;
+        }
+        move->row = w % batch->anchorRows - batch->margin;
+        move->col = __builtin_ctzll(bits) - batch->margin;
+        move->angle = w / batch->anchorRows * 90;
+        return 1;
+    }
+}
+
+/* Places a lane's next tile and records the move. */
+static void place_move(FitzBatch* batch, int lane, FitzMove move) {
+    int t = batch->ply[lane] % batch->library->tilesCount;
+    const TileShape* shape = &batch->library->shapes[t * 4 + move.angle / 90];
+    int player = batch->ply[lane] % 2;
+    for (int m = 0; m < shape->count; m++) {
+        int y = move.row + shape->dy[m] + FREE_BORDER;
+        int bit = move.col + shape->dx[m] + batch->margin + batch->centre;
+        batch->free[(long)y * batch->lanes + lane] &= ~((uint64_t)1 << bit);
+    }
+    int* recent = batch->recent + lane * 6;
+    recent[player * 2] = recent[4] = move.row;
+    recent[player * 2 + 1] = recent[5] = move.col;
+    batch->ply[lane]++;
+}
+
+/* Plays "games" more games, numbered on from the batch's earlier runs, adding
+their outcomes to "results". */
+void fitz_batch_run(FitzBatch* batch, long games, FitzBatchResults* results) {
+    batch->gamesLeft = games;
+    int active = 0;
+    for (int lane = 0; lane < batch->lanes; lane++) {
+        start_lane(batch, lane);
+        active += batch->running[lane];
+    }
+    while (active > 0) {
+        group_lanes(batch);
+        int tilesCount = batch->library->tilesCount;
+        for (int t = 0; t < tilesCount; t++) {
+            int count = batch->tileStart[t + 1] - batch->tileStart[t];
+            if (count > 0) {
+                legal_anchors(batch, t, batch->tileStart[t], count);
+            }
+        }
+        int scans = 0;
+        for (int lane = 0; lane < batch->lanes; lane++) {
+            if (!batch->running[lane]) {
+                continue;
+            }
+            if (batch->ply[lane] < batch->randomPlies) {
+                batch->moved[lane] = random_move(batch, batch->grouping[lane],
+                        &batch->chosen[lane]);
+            } else {
+                start_scan(batch, lane);
+                batch->scanning[scans++] = lane;
+            }
+        }
+        scan_lanes(batch, scans);
+        for (int lane = 0; lane < batch->lanes; lane++) {
+            if (!batch->running[lane]) {
+                continue;
+            }
+            if (batch->moved[lane]) {
+                place_move(batch, lane, batch->chosen[lane]);
+                continue;
+            }
+            // the player left to move has lost
+            results->games++;
+            results->wins[1 - batch->ply[lane] % 2]++;
+            results->plies += batch->ply[lane];
+            start_lane(batch, lane);
+            active -= !batch->running[lane];
+        }
+    }
+}
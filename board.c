@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "internal.h"
+
+
+/* Creates new board as a char array given the number of rows and columns and
+   returns it. */
+char* new_grid(int rows, int cols) {
+    int length = rows * (cols + 1);
+    char* grid = malloc(sizeof(char) * length);
+
+    int currentCol = 1;
+
+    for (int i = 0; i < length; i++) {
+        if (currentCol <= cols) {
+            grid[i] = '.';
+            currentCol++;
+        } else {
+            grid[i] = '\n';
+            currentCol = 1;
+        }
+    }
+    return grid;
+}
+
+/* Reads grid from a saved game file and returns the grid as a char array;
+     returns NULL if invalid contents. */
+char* read_file(FILE* input, int tilesCount) {
+    rewind(input);
+    char* grid = malloc(sizeof(char) * 16);
+    int position = 0;
+    int next = 0;
+    int currentSize = 16; //buffer length
+    int gridLength = 0;
+
+    // don't start reading until after the first line
+    Bool startReading = 0;
+    while (startReading == 0) {
+        next = fgetc(input);
+        if (next == '\n') {
+            startReading = 1;
+        } else if (next == EOF) {
+            free(grid);
+            return NULL;
+        }
+    }
+
+    Bool endReading = 0;
+    while (!endReading) {
+        next = fgetc(input);
+        if (next == EOF) {
+            endReading = 1;
+        } else {
+            if (position == currentSize) {
+                currentSize *= 2;
+                grid = realloc(grid, currentSize);
+            }
+            grid[position++] = (char)next;
+            gridLength++;
+        }
+    }
+
+    int* parameters = read_parameters(input);
+    if(check_saved_game(parameters, grid, gridLength, tilesCount) == 0) {
+        free(parameters);
+        return grid;
+    } else {
+        free(parameters);
+        free(grid);
+        return NULL;
+    }
+}
+
+/* Reads the save file data (excluding the board) and stores the read data in
+an int array, given a file stream to the save file. */
+int* read_parameters(FILE* input) {
+    rewind(input);
+    // stores the read data in a string array
+    char** parametersStorage = malloc(sizeof(char*) * 4);
+    // stores the read data in an int array
+    int* parameters = malloc(sizeof(int) * 4);
+    for (int i = 0; i < 4; i++) {
+        parametersStorage[i] = malloc(sizeof(char) * 10);
+    }
+    int i = 0, j = 0, next = 0;
+    while (i < 4) {
+        next = fgetc(input);
+        if (next == ' ' || next == '\n' || next == EOF) {
+            parametersStorage[i][j] = '\0';
+            j = 0;
+            i++;
+        } else if (j < 9) {
+            parametersStorage[i][j] = next;
+            j++;
+        }
+    }
+    parameters[0] = strtol(parametersStorage[0], NULL, 10);
+    parameters[1] = strtol(parametersStorage[1], NULL, 10);
+    parameters[2] = strtol(parametersStorage[2], NULL, 10);
+    parameters[3] = strtol(parametersStorage[3], NULL, 10);
+    for (int i = 0; i < 4; i++) {
+        free(parametersStorage[i]);
+    }
+    free(parametersStorage);
+    return parameters;
+}
+
+/* Checks the saved game file for valid contents. Returns 0 if valid, otherwise
+     return 1. */
+int check_saved_game(int* parameters, char* grid, int gridLength,
+        int tilesCount) {
+    int nextTile = parameters[0];
+    int nextPlayer = parameters[1];
+    int rows = parameters[2];
+    int cols = parameters[3];
+    // check next player parameter is valid
+    if (!(nextPlayer == 0 || nextPlayer == 1)) {
+        return 1;
+    }
+    // an empty or oversized board can't be played on
+    if (rows < 1 || cols < 1 || rows > FITZ_MAX_DIMENSION ||
+            cols > FITZ_MAX_DIMENSION) {
+        return 1;
+    }
+    // check actual numbers of rows and cols against parameters
+    int rowCount = 0;    //actual row count
+    int colCount = 0;    //actual col count
+    for (int i = 0; i < gridLength; i++) {
+        if (grid[i] == '.' || grid[i] == '*' || grid[i] == '#') {
+            colCount++;
+        } else if (grid[i] == '\n') {
+            if (colCount != cols) {
+                return 1;
+            }
+            colCount = 0;
+            rowCount++;
+        }
+    }
+    if (rowCount != rows) {
+        return 1;
+    }
+    if (nextTile >= tilesCount || nextTile < 0) {
+        return 1;
+    }
+    return 0;
+}
+
+/* Prints the grid char array of the current game to the given output
+stream. */
+void print_grid(Game currentGame, FILE* out) {
+    int length = currentGame.rows * (currentGame.cols + 1);
+    fwrite(currentGame.grid, sizeof(char), length, out);
+}
+
+/* Checks whether the rotated tile "shape" fits with its centre at (y, x): the
+anchor is in the anchor domain and every marker lands on an empty cell. Each
+row of the tile is tested against the free rows with a few word operations.
+Returns 1 if it fits, otherwise 0. */
+Bool tile_fits(const Game* currentGame, const TileShape* shape, int y,
+        int x) {
+    int margin = currentGame->margin;
+    if (y < -margin || y >= currentGame->rows + margin || x < -margin ||
+            x >= currentGame->cols + margin) {
+        return 0;
+    }
+    if (shape->count == 0) {
+        return 1;
+    }
+    int bit = x + shape->minDx + FREE_BORDER;
+    for (int i = 0; i <= shape->maxDy - shape->minDy; i++) {
+        uint64_t cells = (shape->mask >> (8 * i)) & 0xff;
+        const uint64_t* row = currentGame->freeRows +
+                (long)(y + shape->minDy + i + FREE_BORDER) *
+                currentGame->freeWords + bit / 64;
+        uint64_t empty = row[0] >> (bit % 64);
+        if (bit % 64 > 64 - FITZ_MAX_TILE_SIZE) {
+            empty |= row[1] << (64 - bit % 64);
+        }
+        if ((empty & cells) != cells) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Places the rotated tile "shape" for "player" with its centre at (y, x),
+where it must fit, and brings the board's occupancy, occupancy pyramid and
+hash up to date. Every placement on a game's board goes through here. */
+void put_tile(Game* currentGame, const TileShape* shape, int player, int y,
+        int x) {
+    char marker = player == 1 ? '#' : '*';
+    for (int m = 0; m < shape->count; m++) {
+        int r = y + shape->dy[m];
+        int c = x + shape->dx[m];
+        currentGame->grid[r * (currentGame->cols + 1) + c] = marker;
+        currentGame->boardHash ^= cell_key((long)r * currentGame->cols + c,
+                player);
+    }
+    update_occupancy(currentGame, y, x);
+    update_pyramid(currentGame, y, x);
+}
+
+/* Builds the row-wise prefix sums of empty cells of a board (see Game). */
+int* new_empty_counts(char* grid, int rows, int cols) {
+    int* emptyCounts = malloc(sizeof(int) * rows * (cols + 1));
+    Game board = {grid, 0, 0, rows, cols, 0, emptyCounts, 0, NULL, NULL, 0};
+    for (int r = 0; r < rows; r++) {
+        update_empty_counts(&board, r);
+    }
+    return emptyCounts;
+}
+
+/* Recomputes the empty cell counts of the rows a tile anchored on row "y"
+can cover, after the tile has been placed. */
+void update_empty_counts(Game* currentGame, int y) {
+    int cols = currentGame->cols;
+    int margin = currentGame->margin;
+    int top = y - margin < 0 ? 0 : y - margin;
+    int bottom = y + margin >= currentGame->rows ? currentGame->rows - 1 :
+            y + margin;
+    for (int r = top; r <= bottom; r++) {
+        char* row = currentGame->grid + r * (cols + 1);
+        int* counts = currentGame->emptyCounts + r * (cols + 1);
+        counts[0] = 0;
+        for (int c = 0; c < cols; c++) {
+            counts[c + 1] = counts[c] + (row[c] == '.');
+        }
+    }
+}
+
+/* Returns the number of empty cells in rows "top" to "bottom" and columns
+"left" to "right" of the board, ignoring any part of that box off the
+board. */
+long count_empty_cells(const Game* currentGame, int top, int bottom,
+        int left, int right) {
+    int cols = currentGame->cols;
+    top = top < 0 ? 0 : top;
+    bottom = bottom >= currentGame->rows ? currentGame->rows - 1 : bottom;
+    left = left < 0 ? 0 : left;
+    right = right >= cols ? cols - 1 : right;
+    long count = 0;
+    for (int r = top; r <= bottom && left <= right; r++) {
+        int* counts = currentGame->emptyCounts + r * (cols + 1);
+        count += counts[right + 1] - counts[left];
+    }
+    return count;
+}
+
+/* Checks whether the current game is over; returns 1 if yes, otherwise 0. */
+Bool game_over(Game currentGame, const FitzTiles* library) {
+    const TileShape* shapes = library->shapes + currentGame.nextTile * 4;
+    int r, c;
+    return !first_legal_anchor(&currentGame, shapes, FITZ_ALL_ANGLES,
+            -currentGame.margin, -currentGame.margin, 1, &r, &c);
+}
+
+/* Attempts to save the game. Returns 0 if game successfully saved. Otherwise
+   return 1. */
+int save_game(Game currentGame, const char* outputPath) {
+    FILE* output = fopen(outputPath, "w");
+    if (output == NULL) {
+        return 1;
+    }
+    int nextPlayer = currentGame.nextPlayer;
+    int nextTile = currentGame.nextTile;
+    int rows = currentGame.rows;
+    int cols = currentGame.cols;
+    char* grid = currentGame.grid;
+    fprintf(output, "%d %d %d %d\n", nextTile, nextPlayer, rows, cols);
+    fwrite(grid, sizeof(char), rows * (cols + 1), output);
+    fclose(output);
+    return 0;
+}
@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "internal.h"
+
+/* An opening book is a file of precomputed moves for early positions, read by
+mapping it into memory. It starts with a header:
+    magic "FITZBK2\0", tiles hash (8 bytes), rows (4), cols (4),
+    fewest empty cells of a position in the book (8), entry count (8)
+followed by the entries, sorted by position key:
+    position key (8), row (2), column (2), angle / 90 (2), unused (2)
+Numbers are in the machine's byte order. */
+
+#define BOOK_MAGIC "FITZBK2"
+#define BOOK_HEADER_SIZE 40
+#define BOOK_ENTRY_SIZE 16
+
+struct FitzBook {
+    void* data;             // the mapped file
+    size_t size;
+    uint64_t tilesHash;
+    int rows;
+    int cols;
+    long minEmpty;          // positions with fewer empty cells aren't in it
+    long count;
+    const unsigned char* entries;
+};
+
+/* Mixes "length" bytes into an FNV-1a hash. */
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t length) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* Works out the hash of a tile library's tiles, in order, when it is loaded
+(see fitz_tiles_hash()). */
+uint64_t hash_tiles(const FitzTiles* tiles) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < tiles->tilesCount; i++) {
+        hash = hash_bytes(hash, tiles->tiles[i],
+                tiles->size * (tiles->size + 1));
+    }
+    return hash;
+}
+
+/* Returns a hash of a tile library's tiles, in order, which identifies the
+tile file it was loaded from. */
+uint64_t fitz_tiles_hash(const FitzTiles* tiles) {
+    return tiles->hash;
+}
+
+/* Returns the key under which a game's position is kept in opening books and,
+with the question asked, in position caches: a hash of its tiles, board
+dimensions, next tile, player to move and board. It is made from hashes the
+game keeps up to date, so it takes constant time. */
+uint64_t fitz_game_position_key(const FitzGame* game) {
+    const Game* state = &game->state;
+    return mix_bits(game->keyBase ^ state->boardHash ^
+            mix_bits((uint64_t)state->nextTile << 1 | state->nextPlayer));
+}
+
+/* Counts the empty cells of a game's board. */
+static long game_empty_cells(const FitzGame* game) {
+    return count_empty_cells(&game->state, 0, game->state.rows - 1, 0,
+            game->state.cols - 1);
+}
+
+/* Writes an opening book for games of "tiles" on a rows x cols board to
+"path". The entries may come in any order; of several for the same position
+the first is kept. */
+FitzError fitz_book_write(const char* path, const FitzTiles* tiles, int rows,
+        int cols, const FitzBookEntry* entries, long count) {
+    FitzBookEntry* sorted = malloc(sizeof(FitzBookEntry) * (count + 1));
+    long kept = 0;
+    // insertion into a sorted array is fine for the few positions of a book
+    for (long i = 0; i < count; i++) {
+        long low = 0;
+        long high = kept;
+        while (low < high) {
+            long middle = (low + high) / 2;
+            if (sorted[middle].key < entries[i].key) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (low < kept && sorted[low].key == entries[i].key) {
+            continue;
+        }
+        memmove(sorted + low + 1, sorted + low,
+                sizeof(FitzBookEntry) * (kept - low));
+        sorted[low] = entries[i];
+        kept++;
+    }
+    FILE* out = fopen(path, "wb");
+    if (out == NULL) {
+        free(sorted);
+        return FITZ_ERR_BOOK_WRITE;
+    }
+    unsigned char header[BOOK_HEADER_SIZE] = {0};
+    uint64_t tilesHash = tiles->hash;
+    int32_t dimensions[2] = {rows, cols};
+    int64_t minEmpty = (int64_t)rows * cols;
+    int64_t entryCount = kept;
+    for (long i = 0; i < kept; i++) {
+        if (sorted[i].emptyCells < minEmpty) {
+            minEmpty = sorted[i].emptyCells;
+        }
+    }
+    memcpy(header, BOOK_MAGIC, 8);
+    memcpy(header + 8, &tilesHash, 8);
+    memcpy(header + 16, dimensions, 8);
+    memcpy(header + 24, &minEmpty, 8);
+    memcpy(header + 32, &entryCount, 8);
+    fwrite(header, 1, BOOK_HEADER_SIZE, out);
+    for (long i = 0; i < kept; i++) {
+        unsigned char entry[BOOK_ENTRY_SIZE] = {0};
+        int16_t move[3] = {sorted[i].move.row, sorted[i].move.col,
+                sorted[i].move.angle / 90};
+        memcpy(entry, &sorted[i].key, 8);
+        memcpy(entry + 8, move, 6);
+        fwrite(entry, 1, BOOK_ENTRY_SIZE, out);
+    }
+    free(sorted);
+    if (fclose(out) != 0) {
+        return FITZ_ERR_BOOK_WRITE;
+    }
+    return FITZ_OK;
+}
+
+/* Maps the opening book at "path" into memory. The book must have been made
+for "tiles". */
+FitzError fitz_book_open(const FitzTiles* tiles, const char* path,
+        FitzBook** bookPtr) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return FITZ_ERR_BOOK_ACCESS;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == -1 || info.st_size < BOOK_HEADER_SIZE) {
+        close(fd);
+        return FITZ_ERR_BOOK_CONTENTS;
+    }
+    void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return FITZ_ERR_BOOK_ACCESS;
+    }
+    const unsigned char* header = data;
+    FitzBook* book = malloc(sizeof(FitzBook));
+    book->data = data;
+    book->size = info.st_size;
+    int32_t dimensions[2];
+    int64_t minEmpty;
+    int64_t count;
+    memcpy(&book->tilesHash, header + 8, 8);
+    memcpy(dimensions, header + 16, 8);
+    memcpy(&minEmpty, header + 24, 8);
+    memcpy(&count, header + 32, 8);
+    book->rows = dimensions[0];
+    book->cols = dimensions[1];
+    book->minEmpty = minEmpty;
+    book->count = count;
+    book->entries = header + BOOK_HEADER_SIZE;
+    if (memcmp(header, BOOK_MAGIC, 8) != 0 || count < 0 ||
+            (info.st_size - BOOK_HEADER_SIZE) / BOOK_ENTRY_SIZE != count ||
+            book->tilesHash != tiles->hash) {
+        fitz_book_free(book);
+        return FITZ_ERR_BOOK_CONTENTS;
+    }
+    *bookPtr = book;
+    return FITZ_OK;
+}
+
+/* Unmaps and frees an opening book. */
+void fitz_book_free(FitzBook* book) {
+    munmap(book->data, book->size);
+    free(book);
+}
+
+/* Returns the number of positions in an opening book. */
+long fitz_book_count(const FitzBook* book) {
+    return book->count;
+}
+
+/* Looks up the move an opening book gives for a game's position, storing it
+in "move". Returns 1 if the book has the position, otherwise 0. */
+int fitz_book_lookup(const FitzBook* book, const FitzGame* game,
+        FitzMove* move) {
+    if (book->count == 0 || game->state.rows != book->rows ||
+            game->state.cols != book->cols ||
+            game_empty_cells(game) < book->minEmpty) {
+        return 0;
+    }
+    uint64_t key = fitz_game_position_key(game);
+    long low = 0;
+    long high = book->count;
+    while (low < high) {
+        long middle = (low + high) / 2;
+        uint64_t entryKey;
+        memcpy(&entryKey, book->entries + middle * BOOK_ENTRY_SIZE, 8);
+        if (entryKey < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == book->count) {
+        return 0;
+    }
+    const unsigned char* entry = book->entries + low * BOOK_ENTRY_SIZE;
+    uint64_t entryKey;
+    int16_t stored[3];
+    memcpy(&entryKey, entry, 8);
+    memcpy(stored, entry + 8, 6);
+    if (entryKey != key) {
+        return 0;
+    }
+    move->row = stored[0];
+    move->col = stored[1];
+    move->angle = stored[2] * 90;
+    return 1;
+}
+
+/* Makes an entry for a game's position and the move to play in it. */
+void fitz_book_entry(const FitzGame* game, FitzMove move,
+        FitzBookEntry* entry) {
+    entry->key = fitz_game_position_key(game);
+    entry->emptyCells = game_empty_cells(game);
+    entry->move = move;
+}
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "internal.h"
+
+/* A position cache is a fixed-size file of answers about positions (is the
+game over, which move does an automated player make), shared by every process
+that maps it. It starts with a header:
+    magic "FITZPC1\0", slot count (8), unused (48)
+followed by the slots, CACHE_BUCKET_SLOTS to a bucket:
+    key ^ answer (8), answer (8)
+Numbers are in the machine's byte order. A slot's two words are read and
+written atomically but separately, and an answer is only taken if the words
+agree with the key asked about, so processes and threads need no locks: an
+answer torn by a concurrent write reads as a miss. */
+
+#define CACHE_MAGIC "FITZPC1"
+#define CACHE_HEADER_SIZE 64
+#define CACHE_SLOT_SIZE 16
+// slots of a new cache file: 16 MiB
+#define CACHE_SLOTS (1L << 20)
+// slots a key may be kept in, one cache line
+#define CACHE_BUCKET_SLOTS 4
+
+struct FitzCache {
+    void* data;             // the mapped file
+    size_t size;
+    long buckets;
+    uint64_t* slots;        // two words per slot
+};
+
+/* Scrambles a 64-bit number (the splitmix64 finaliser). */
+uint64_t mix_bits(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/* Returns the random number a marker of "player" on board cell "cell"
+(row * cols + column) adds to a board's hash. */
+uint64_t cell_key(long cell, int player) {
+    return mix_bits((uint64_t)cell * 2 + player);
+}
+
+/* Returns the hash of a board, the XOR of the keys of its markers. put_tile()
+keeps it up to date as tiles are placed. */
+uint64_t board_hash(const Game* currentGame) {
+    uint64_t hash = 0;
+    for (int r = 0; r < currentGame->rows; r++) {
+        for (int c = 0; c < currentGame->cols; c++) {
+            char cell = currentGame->grid[r * (currentGame->cols + 1) + c];
+            if (cell != '.') {
+                hash ^= cell_key((long)r * currentGame->cols + c,
+                        cell == '#');
+            }
+        }
+    }
+    return hash;
+}
+
+/* Returns the key under which the answer to "query" (a CacheQuery with its
+parameters above the low 8 bits) about a game's position is cached: a hash of
+the question and the position's key (see fitz_game_position_key()). Keys are
+odd, so that no key matches an empty slot. */
+uint64_t position_query_key(const FitzGame* game, uint64_t query) {
+    return mix_bits(fitz_game_position_key(game) ^ mix_bits(query)) | 1;
+}
+
+/* Writes the header of a new cache file and sets its size. Returns 0 on
+success, otherwise -1. */
+static int create_cache_file(int fd) {
+    unsigned char header[CACHE_HEADER_SIZE] = {0};
+    int64_t slotCount = CACHE_SLOTS;
+    memcpy(header, CACHE_MAGIC, 8);
+    memcpy(header + 8, &slotCount, 8);
+    if (ftruncate(fd, CACHE_HEADER_SIZE + CACHE_SLOTS * CACHE_SLOT_SIZE) ==
+            -1 || pwrite(fd, header, CACHE_HEADER_SIZE, 0) !=
+            CACHE_HEADER_SIZE) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Maps the position cache at "path" into memory for reading and writing,
+creating it if it doesn't exist. Any number of processes may have the same
+cache open. */
+FitzError fitz_cache_open(const char* path, FitzCache** cachePtr) {
+    int fd = open(path, O_RDWR | O_CREAT, 0666);
+    if (fd == -1) {
+        return FITZ_ERR_CACHE_ACCESS;
+    }
+    // a process creating the file holds a lock until the header is written,
+    // so others opening it at the same time never see it half made
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    struct stat info;
+    if (fcntl(fd, F_SETLKW, &lock) == -1 || fstat(fd, &info) == -1 ||
+            (info.st_size == 0 && create_cache_file(fd) == -1) ||
+            fstat(fd, &info) == -1) {
+        close(fd);
+        return FITZ_ERR_CACHE_ACCESS;
+    }
+    if (info.st_size < CACHE_HEADER_SIZE) {
+        close(fd);
+        return FITZ_ERR_CACHE_CONTENTS;
+    }
+    void* data = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+            fd, 0);
+    // closing the file releases the lock
+    close(fd);
+    if (data == MAP_FAILED) {
+        return FITZ_ERR_CACHE_ACCESS;
+    }
+    const unsigned char* header = data;
+    int64_t slotCount;
+    memcpy(&slotCount, header + 8, 8);
+    if (memcmp(header, CACHE_MAGIC, 8) != 0 || slotCount < 1 ||
+            slotCount % CACHE_BUCKET_SLOTS != 0 ||
+            (info.st_size - CACHE_HEADER_SIZE) / CACHE_SLOT_SIZE !=
+            slotCount) {
+        munmap(data, info.st_size);
+        return FITZ_ERR_CACHE_CONTENTS;
+    }
+    FitzCache* cache = malloc(sizeof(FitzCache));
+    cache->data = data;
+    cache->size = info.st_size;
+    cache->buckets = slotCount / CACHE_BUCKET_SLOTS;
+    cache->slots = (uint64_t*)((unsigned char*)data + CACHE_HEADER_SIZE);
+    *cachePtr = cache;
+    return FITZ_OK;
+}
+
+/* Unmaps and frees a position cache. Its answers stay in the file. */
+void fitz_cache_free(FitzCache* cache) {
+    munmap(cache->data, cache->size);
+    free(cache);
+}
+
+/* Returns the first slot of the bucket "key" is kept in. */
+static uint64_t* cache_bucket(const FitzCache* cache, uint64_t key) {
+    return cache->slots + (key % cache->buckets) * CACHE_BUCKET_SLOTS * 2;
+}
+
+/* Looks up the answer cached under "key", storing it in "value". Returns 1 if
+there is one, otherwise 0. */
+Bool cache_lookup(const FitzCache* cache, uint64_t key, uint64_t* value) {
+    uint64_t* slot = cache_bucket(cache, key);
+    for (int i = 0; i < CACHE_BUCKET_SLOTS; i++, slot += 2) {
+        uint64_t check = __atomic_load_n(&slot[0], __ATOMIC_RELAXED);
+        uint64_t answer = __atomic_load_n(&slot[1], __ATOMIC_RELAXED);
+        if ((check ^ answer) == key) {
+            *value = answer;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Caches "value" as the answer under "key". It takes the key's old slot, or
+else an empty one; in a full bucket the slot chosen by the key's high bits
+is overwritten. */
+void cache_store(FitzCache* cache, uint64_t key, uint64_t value) {
+    uint64_t* bucket = cache_bucket(cache, key);
+    // the top two bits pick one of the bucket's four slots
+    uint64_t* target = bucket + (key >> 62) * 2;
+    for (int i = CACHE_BUCKET_SLOTS - 1; i >= 0; i--) {
+        uint64_t* slot = bucket + i * 2;
+        uint64_t check = __atomic_load_n(&slot[0], __ATOMIC_RELAXED);
+        uint64_t answer = __atomic_load_n(&slot[1], __ATOMIC_RELAXED);
+        if ((check ^ answer) == key) {
+            target = slot;
+            break;
+        }
+        if (check == 0 && answer == 0) {
+            target = slot;
+        }
+    }
+    __atomic_store_n(&target[1], value, __ATOMIC_RELAXED);
+    __atomic_store_n(&target[0], key ^ value, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,306 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "engine.h"
+#include "timing.h"
+
+/* Checks whether a player type names an external engine ("e:command" or
+"eMOVE_MS[,CLOCK_MS]:command"). Returns 1 if yes, otherwise 0. */
+Bool is_engine_type(char* pType) {
+    char* command;
+    int moveMs;
+    long clockMs;
+    return parse_engine_type(pType, &command, &moveMs, &clockMs);
+}
+
+/* Splits an engine player type into the command to run, the per-move limit and
+the game clock (-1 if none). Returns 0 if the player type is not an engine. */
+Bool parse_engine_type(char* pType, char** command, int* moveMs,
+        long* clockMs) {
+    if (pType[0] != 'e') {
+        return 0;
+    }
+    char* colon = strchr(pType, ':');
+    if (colon == NULL || colon[1] == '\0') {
+        return 0;
+    }
+    *moveMs = ENGINE_DEFAULT_MOVE_MS;
+    *clockMs = -1;
+    char* position = pType + 1;
+    if (position != colon) {
+        char* end;
+        long value = strtol(position, &end, 10);
+        if (end == position || value < 1 || value > 3600000) {
+            return 0;
+        }
+        *moveMs = (int)value;
+        if (*end == ',') {
+            position = end + 1;
+            value = strtol(position, &end, 10);
+            if (end == position || value < 1) {
+                return 0;
+            }
+            *clockMs = value;
+        }
+        if (end != colon) {
+            return 0;
+        }
+    }
+    *command = colon + 1;
+    return 1;
+}
+
+/* Writes "length" bytes to the engine, giving up at "deadline" (in
+milliseconds on the monotonic clock). */
+static EngineStatus engine_write(Engine* engine, char* data, size_t length,
+        double deadline) {
+    size_t written = 0;
+    while (written < length) {
+        ssize_t count = write(engine->toEngine, data + written,
+                length - written);
+        if (count >= 0) {
+            written += count;
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return ENGINE_CLOSED;
+        }
+        int remaining = (int)(deadline - fitz_now_millis());
+        if (remaining <= 0) {
+            return ENGINE_TIMEOUT;
+        }
+        struct pollfd ready = {engine->toEngine, POLLOUT, 0};
+        poll(&ready, 1, remaining);
+    }
+    return ENGINE_OK;
+}
+
+/* Reads one reply line from the engine into "line" (without its newline),
+giving up at "deadline". Data after the line stays buffered for the next
+call. */
+static EngineStatus engine_read_line(Engine* engine, char* line,
+        double deadline) {
+    while (1) {
+        char* newline = memchr(engine->buffer, '\n', engine->bufferLength);
+        if (newline != NULL) {
+            int length = newline - engine->buffer;
+            memcpy(line, engine->buffer, length);
+            line[length] = '\0';
+            engine->bufferLength -= length + 1;
+            memmove(engine->buffer, newline + 1, engine->bufferLength);
+            return ENGINE_OK;
+        }
+        if (engine->bufferLength == ENGINE_LINE_LENGTH) {
+            return ENGINE_BAD_REPLY;
+        }
+        ssize_t count = read(engine->fromEngine,
+                engine->buffer + engine->bufferLength,
+                ENGINE_LINE_LENGTH - engine->bufferLength);
+        if (count > 0) {
+            engine->bufferLength += count;
+            continue;
+        }
+        if (count == 0) {
+            return ENGINE_CLOSED;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return ENGINE_CLOSED;
+        }
+        int remaining = (int)(deadline - fitz_now_millis());
+        if (remaining <= 0) {
+            return ENGINE_TIMEOUT;
+        }
+        struct pollfd ready = {engine->fromEngine, POLLIN, 0};
+        poll(&ready, 1, remaining);
+    }
+}
+
+/* Launches the engine named by an engine player type and performs the
+handshake: the engine is sent the protocol version and the tiles, and must
+answer "ready". On success "*enginePtr" holds the running engine. */
+EngineStatus engine_start(char* pType, const FitzTiles* tiles,
+        Engine** enginePtr) {
+    char* command;
+    int moveMs;
+    long clockMs;
+    int toChild[2];
+    int fromChild[2];
+    if (!parse_engine_type(pType, &command, &moveMs, &clockMs) ||
+            pipe(toChild) == -1) {
+        return ENGINE_CLOSED;
+    }
+    if (pipe(fromChild) == -1) {
+        close(toChild[0]);
+        close(toChild[1]);
+        return ENGINE_CLOSED;
+    }
+    // a dead engine should surface as a failed write, not kill the game
+    signal(SIGPIPE, SIG_IGN);
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(toChild[0], STDIN_FILENO);
+        dup2(fromChild[1], STDOUT_FILENO);
+        close(toChild[0]);
+        close(toChild[1]);
+        close(fromChild[0]);
+        close(fromChild[1]);
+        execl("/bin/sh", "sh", "-c", command, (char*)NULL);
+        _exit(127);
+    }
+    close(toChild[0]);
+    close(fromChild[1]);
+    if (pid == -1) {
+        close(toChild[1]);
+        close(fromChild[0]);
+        return ENGINE_CLOSED;
+    }
+    Engine* engine = malloc(sizeof(Engine));
+    engine->pid = pid;
+    engine->toEngine = toChild[1];
+    engine->fromEngine = fromChild[0];
+    engine->moveMs = moveMs;
+    engine->clockMs = clockMs;
+    engine->bufferLength = 0;
+    fcntl(engine->toEngine, F_SETFD, FD_CLOEXEC);
+    fcntl(engine->fromEngine, F_SETFD, FD_CLOEXEC);
+    fcntl(engine->toEngine, F_SETFL, O_NONBLOCK);
+    fcntl(engine->fromEngine, F_SETFL, O_NONBLOCK);
+
+    char* message;
+    size_t length;
+    FILE* out = open_memstream(&message, &length);
+    int tilesCount = fitz_tiles_count(tiles);
+    fprintf(out, "fitz %d %d\n", ENGINE_PROTOCOL_VERSION, tilesCount);
+    for (int i = 0; i < tilesCount; i++) {
+        fitz_tiles_print(tiles, i, out);
+    }
+    fclose(out);
+    double deadline = fitz_now_millis() + ENGINE_START_MS;
+    char line[ENGINE_LINE_LENGTH + 1];
+    EngineStatus status = engine_write(engine, message, length, deadline);
+    free(message);
+    if (status == ENGINE_OK) {
+        status = engine_read_line(engine, line, deadline);
+    }
+    if (status == ENGINE_OK && strcmp(line, "ready") != 0) {
+        status = ENGINE_BAD_REPLY;
+    }
+    if (status != ENGINE_OK) {
+        engine_stop(engine);
+        return status;
+    }
+    *enginePtr = engine;
+    return ENGINE_OK;
+}
+
+/* Parses an engine's "r c angle" reply. Returns 0 if it is malformed. */
+static Bool parse_engine_move(char* line, FitzMove* move) {
+    char extra;
+    if (sscanf(line, "%d %d %d %c", &move->row, &move->col, &move->angle,
+            &extra) != 3) {
+        return 0;
+    }
+    return move->angle == 0 || move->angle == 90 || move->angle == 180 ||
+            move->angle == 270;
+}
+
+/* Asks the engine for a move in each of "count" positions at once. A single
+position is sent as a bare "position" block; several are preceded by
+"batch count" and answered with one "r c angle" line each, in order. The
+time spent is charged to the engine's clock and the whole batch must be
+answered within the per-move limit (or the remaining clock if smaller). */
+EngineStatus engine_request_moves(Engine* engine, FitzGame** positions,
+        int count, FitzMove* moves) {
+    long budget = engine->moveMs;
+    if (engine->clockMs >= 0 && engine->clockMs < budget) {
+        budget = engine->clockMs;
+    }
+    double start = fitz_now_millis();
+    double deadline = start + budget;
+
+    char* message;
+    size_t length;
+    FILE* out = open_memstream(&message, &length);
+    if (count > 1) {
+        fprintf(out, "batch %d\n", count);
+    }
+    for (int i = 0; i < count; i++) {
+        FitzGame* position = positions[i];
+        fprintf(out, "position %d %d %d %d %ld %d\n",
+                fitz_game_next_tile(position), fitz_game_next_player(position),
+                fitz_game_rows(position), fitz_game_cols(position),
+                engine->clockMs, engine->moveMs);
+        fitz_game_print(position, out);
+    }
+    fclose(out);
+    EngineStatus status = engine_write(engine, message, length, deadline);
+    free(message);
+
+    char line[ENGINE_LINE_LENGTH + 1];
+    for (int i = 0; i < count && status == ENGINE_OK; i++) {
+        status = engine_read_line(engine, line, deadline);
+        if (status == ENGINE_OK && !parse_engine_move(line, &moves[i])) {
+            status = ENGINE_BAD_REPLY;
+        }
+    }
+    if (engine->clockMs >= 0) {
+        engine->clockMs -= (long)(fitz_now_millis() - start);
+        if (engine->clockMs < 0) {
+            engine->clockMs = 0;
+        }
+    }
+    return status;
+}
+
+/* Asks the engine for its move in the current game. */
+EngineStatus engine_request_move(Engine* engine, FitzGame* currentGame,
+        FitzMove* chosen) {
+    return engine_request_moves(engine, &currentGame, 1, chosen);
+}
+
+/* Tells the engine to quit, gives it a moment to exit and then reaps it
+(killing it if it hasn't exited). Frees the engine. */
+void engine_stop(Engine* engine) {
+    write(engine->toEngine, "quit\n", 5);
+    close(engine->toEngine);
+    close(engine->fromEngine);
+    struct timespec pause = {0, 1000000};
+    int waited = 0;
+    while (waitpid(engine->pid, NULL, WNOHANG) == 0) {
+        if (waited++ == 100) {
+            kill(engine->pid, SIGKILL);
+            waitpid(engine->pid, NULL, 0);
+            break;
+        }
+        nanosleep(&pause, NULL);
+    }
+    free(engine);
+}
+
+/* Returns a description of an engine failure for error messages. */
+char* engine_status_message(EngineStatus status) {
+    switch (status) {
+        case ENGINE_TIMEOUT:
+            return "timed out";
+        case ENGINE_CLOSED:
+            return "exited";
+        case ENGINE_BAD_REPLY:
+            return "sent an invalid reply";
+        default:
+            return "ok";
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <sys/types.h>
+#include "head.h"
+
+// version number sent in the opening "fitz" line of the protocol
+#define ENGINE_PROTOCOL_VERSION 1
+// default limit on each move when the player type gives none
+#define ENGINE_DEFAULT_MOVE_MS 1000
+// time allowed for an engine to answer the handshake with "ready"
+#define ENGINE_START_MS 5000
+// longest reply line accepted from an engine
+#define ENGINE_LINE_LENGTH 128
+
+typedef enum {
+    ENGINE_OK,
+    ENGINE_TIMEOUT,     // no (complete) reply before the deadline
+    ENGINE_CLOSED,      // the engine exited or closed its pipes
+    ENGINE_BAD_REPLY    // a reply that isn't "r c angle" (or "ready")
+} EngineStatus;
+
+// an external program playing one side of a game over a pair of pipes
+struct Engine {
+    pid_t pid;
+    int toEngine;
+    int fromEngine;
+    int moveMs;     // per-move time limit in milliseconds
+    long clockMs;   // game time left in milliseconds, or -1 if unlimited
+    char buffer[ENGINE_LINE_LENGTH];
+    int bufferLength;
+};
+
+Bool is_engine_type(char* pType);
+Bool parse_engine_type(char* pType, char** command, int* moveMs,
+        long* clockMs);
+EngineStatus engine_start(char* pType, const FitzTiles* tiles,
+        Engine** enginePtr);
+EngineStatus engine_request_moves(Engine* engine, FitzGame** positions,
+        int count, FitzMove* moves);
+EngineStatus engine_request_move(Engine* engine, FitzGame* currentGame,
+        FitzMove* chosen);
+void engine_stop(Engine* engine);
+char* engine_status_message(EngineStatus status);
+
+#endif
@@ -0,0 +1,394 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "internal.h"
+
+// width of the blocked border around the evaluation board (see occupancy.c)
+#define EVAL_BORDER FREE_BORDER
+// room for the marker offsets of one shape
+#define EVAL_MARKERS (FITZ_MAX_TILE_SIZE * FITZ_MAX_TILE_SIZE)
+
+struct FitzEval {
+    const FitzTiles* library;
+    int rows;
+    int cols;
+    int nextTile;
+    int nextPlayer;
+    int margin;             // how far anchors reach off the board
+    // anchors whose legality a placement can change are at most this many
+    // rows or columns from its anchor: twice the margin
+    int reach;
+    int paddedWidth;        // cols + 2 * EVAL_BORDER
+    char* cells;            // padded board: '.', '*', '#' or ' ' (border)
+    int* covers;            // per padded cell, legal placements covering it
+    int anchorWidth;        // cols + 2 * margin
+    long anchorCount;       // (rows + 2 * margin) * (cols + 2 * margin)
+    unsigned char* legal;   // per tile and anchor, a FITZ_ANGLE_BIT set
+    int* offsets;           // per shape, EVAL_MARKERS offsets into "cells"
+    long* legalCounts;      // per shape, number of legal anchors
+    long emptyCells;
+    long reachableCells;
+    FitzMove* history;      // placements made with fitz_eval_place()
+    int historyLength;
+    int historyCapacity;
+};
+
+/* Returns the index into "cells" of the centre of anchor (r, c). */
+static long anchor_cell(const FitzEval* eval, int r, int c) {
+    return (long)(r + EVAL_BORDER) * eval->paddedWidth + c + EVAL_BORDER;
+}
+
+/* Returns the rotations of tile "tile" that fit at the anchor whose centre is
+at "cell", as a set of FITZ_ANGLE_BIT values. */
+static int fitting_angles(const FitzEval* eval, int tile, long cell) {
+    int angles = 0;
+    for (int a = 0; a < 4; a++) {
+        int shape = tile * 4 + a;
+        const int* shapeOffsets = eval->offsets + shape * EVAL_MARKERS;
+        int markers = eval->library->shapes[shape].count;
+        int m = 0;
+        while (m < markers && eval->cells[cell + shapeOffsets[m]] == '.') {
+            m++;
+        }
+        if (m == markers) {
+            angles |= 1 << a;
+        }
+    }
+    return angles;
+}
+
+/* Adds "change" (1 or -1) to the covers of the cells under shape "shape" at
+the anchor whose centre is at "cell", keeping the reachable cell count. */
+static void cover_shape(FitzEval* eval, int shape, long cell, int change) {
+    const int* shapeOffsets = eval->offsets + shape * EVAL_MARKERS;
+    int markers = eval->library->shapes[shape].count;
+    for (int m = 0; m < markers; m++) {
+        int* cover = &eval->covers[cell + shapeOffsets[m]];
+        if (*cover == 0) {
+            eval->reachableCells++;
+        }
+        *cover += change;
+        if (*cover == 0) {
+            eval->reachableCells--;
+        }
+    }
+}
+
+/* Rechecks every tile in every rotation at the anchors within "reach" rows
+and columns of anchor (r, c), updating the legal sets, legal counts and
+covers of those that changed. */
+static void refresh_anchors(FitzEval* eval, int r, int c, int reach) {
+    int tilesCount = eval->library->tilesCount;
+    int margin = eval->margin;
+    int top = r - reach < -margin ? -margin : r - reach;
+    int bottom = r + reach > eval->rows + margin - 1 ?
+            eval->rows + margin - 1 : r + reach;
+    int left = c - reach < -margin ? -margin : c - reach;
+    int right = c + reach > eval->cols + margin - 1 ?
+            eval->cols + margin - 1 : c + reach;
+    for (int y = top; y <= bottom; y++) {
+        for (int x = left; x <= right; x++) {
+            long cell = anchor_cell(eval, y, x);
+            long anchor = (long)(y + margin) * eval->anchorWidth + x +
+                    margin;
+            for (int t = 0; t < tilesCount; t++) {
+                unsigned char* legal = &eval->legal[t * eval->anchorCount +
+                        anchor];
+                int angles = fitting_angles(eval, t, cell);
+                int changed = angles ^ *legal;
+                for (int a = 0; changed != 0 && a < 4; a++) {
+                    if (!(changed & (1 << a))) {
+                        continue;
+                    }
+                    int change = (angles & (1 << a)) ? 1 : -1;
+                    eval->legalCounts[t * 4 + a] += change;
+                    cover_shape(eval, t * 4 + a, cell, change);
+                }
+                *legal = angles;
+            }
+        }
+    }
+}
+
+/* Sets up incremental evaluation of a game's current position. The evaluator
+keeps its own copy of the board, so the game may change or be freed while it
+is in use (but not its tile library). */
+FitzError fitz_eval_new(const FitzGame* game, FitzEval** evalPtr) {
+    const FitzTiles* library = game->library;
+    int rows = game->state.rows;
+    int cols = game->state.cols;
+    FitzEval* eval = malloc(sizeof(FitzEval));
+    eval->library = library;
+    eval->rows = rows;
+    eval->cols = cols;
+    eval->nextTile = game->state.nextTile;
+    eval->nextPlayer = game->state.nextPlayer;
+    eval->margin = library->margin;
+    eval->reach = 2 * library->margin;
+    eval->paddedWidth = cols + 2 * EVAL_BORDER;
+    long cellCount = (long)eval->paddedWidth * (rows + 2 * EVAL_BORDER);
+    eval->cells = malloc(cellCount);
+    memset(eval->cells, ' ', cellCount);
+    eval->covers = calloc(cellCount, sizeof(int));
+    eval->emptyCells = 0;
+    for (int r = 0; r < rows; r++) {
+        memcpy(eval->cells + anchor_cell(eval, r, 0),
+                game->state.grid + r * (cols + 1), cols);
+        for (int c = 0; c < cols; c++) {
+            eval->emptyCells += game->state.grid[r * (cols + 1) + c] == '.';
+        }
+    }
+    eval->anchorWidth = cols + 2 * eval->margin;
+    eval->anchorCount = (long)eval->anchorWidth * (rows + 2 * eval->margin);
+    eval->legal = calloc(library->tilesCount * eval->anchorCount, 1);
+    eval->offsets = malloc(sizeof(int) * EVAL_MARKERS * 4 *
+            library->tilesCount);
+    eval->legalCounts = calloc(4 * library->tilesCount, sizeof(long));
+    for (int s = 0; s < 4 * library->tilesCount; s++) {
+        const TileShape* shape = &library->shapes[s];
+        for (int m = 0; m < shape->count; m++) {
+            eval->offsets[s * EVAL_MARKERS + m] = shape->dy[m] *
+                    eval->paddedWidth +
+                    shape->dx[m];
+        }
+    }
+    eval->reachableCells = 0;
+    eval->history = NULL;
+    eval->historyLength = 0;
+    eval->historyCapacity = 0;
+    // a refresh with a reach covering the whole board fills everything in
+    refresh_anchors(eval, -eval->margin, -eval->margin,
+            rows + cols + 4 * eval->margin);
+    *evalPtr = eval;
+    return FITZ_OK;
+}
+
+/* Frees an evaluator. */
+void fitz_eval_free(FitzEval* eval) {
+    free(eval->cells);
+    free(eval->covers);
+    free(eval->legal);
+    free(eval->offsets);
+    free(eval->legalCounts);
+    free(eval->history);
+    free(eval);
+}
+
+/* Checks whether the next tile can be placed by the player to move in the
+evaluator's position. Returns 1 if yes, otherwise 0. */
+int fitz_eval_is_legal(const FitzEval* eval, FitzMove move) {
+    int margin = eval->margin;
+    if (move.row < -margin || move.row >= eval->rows + margin ||
+            move.col < -margin || move.col >= eval->cols + margin ||
+            move.angle < 0 || move.angle > 270 || move.angle % 90 != 0) {
+        return 0;
+    }
+    long anchor = (long)(move.row + margin) * eval->anchorWidth + move.col +
+            margin;
+    return (eval->legal[eval->nextTile * eval->anchorCount + anchor] >>
+            (move.angle / 90)) & 1;
+}
+
+/* Places the next tile for the player to move in the evaluator's position and
+passes the turn on, updating the features near the placement only. */
+FitzError fitz_eval_place(FitzEval* eval, FitzMove move) {
+    if (!fitz_eval_is_legal(eval, move)) {
+        return FITZ_ERR_INVALID_MOVE;
+    }
+    if (eval->historyLength == eval->historyCapacity) {
+        eval->historyCapacity = eval->historyCapacity * 2 + 16;
+        eval->history = realloc(eval->history,
+                sizeof(FitzMove) * eval->historyCapacity);
+    }
+    eval->history[eval->historyLength++] = move;
+    int shape = eval->nextTile * 4 + move.angle / 90;
+    const int* shapeOffsets = eval->offsets + shape * EVAL_MARKERS;
+    int markers = eval->library->shapes[shape].count;
+    long cell = anchor_cell(eval, move.row, move.col);
+    char marker = eval->nextPlayer == 1 ? '#' : '*';
+    for (int m = 0; m < markers; m++) {
+        eval->cells[cell + shapeOffsets[m]] = marker;
+    }
+    eval->emptyCells -= markers;
+    refresh_anchors(eval, move.row, move.col, eval->reach);
+    eval->nextPlayer = (eval->nextPlayer + 1) % 2;
+    eval->nextTile = (eval->nextTile + 1) % eval->library->tilesCount;
+    return FITZ_OK;
+}
+
+/* Takes back the last placement made with fitz_eval_place(). */
+FitzError fitz_eval_undo(FitzEval* eval) {
+    if (eval->historyLength == 0) {
+        return FITZ_ERR_ARGUMENT;
+    }
+    FitzMove move = eval->history[--eval->historyLength];
+    int tilesCount = eval->library->tilesCount;
+    eval->nextPlayer = (eval->nextPlayer + 1) % 2;
+    eval->nextTile = (eval->nextTile + tilesCount - 1) % tilesCount;
+    int shape = eval->nextTile * 4 + move.angle / 90;
+    const int* shapeOffsets = eval->offsets + shape * EVAL_MARKERS;
+    int markers = eval->library->shapes[shape].count;
+    long cell = anchor_cell(eval, move.row, move.col);
+    for (int m = 0; m < markers; m++) {
+        eval->cells[cell + shapeOffsets[m]] = '.';
+    }
+    eval->emptyCells += markers;
+    refresh_anchors(eval, move.row, move.col, eval->reach);
+    return FITZ_OK;
+}
+
+/* Returns the number of legal placements (anchor and rotation) of a tile. */
+static long tile_mobility(const FitzEval* eval, int tile) {
+    const long* counts = eval->legalCounts + tile * 4;
+    return counts[0] + counts[1] + counts[2] + counts[3];
+}
+
+/* Stores the features of the evaluator's position in "features". */
+void fitz_eval_features(const FitzEval* eval, FitzEvalFeatures* features) {
+    int tilesCount = eval->library->tilesCount;
+    features->nextPlayer = eval->nextPlayer;
+    features->emptyCells = eval->emptyCells;
+    features->reachableCells = eval->reachableCells;
+    for (int k = 0; k < FITZ_EVAL_TILES; k++) {
+        // the player to move places tiles nextTile, nextTile + 2, ... and
+        // the other player nextTile + 1, nextTile + 3, ...
+        int mover = eval->nextPlayer;
+        features->mobility[mover][k] = tile_mobility(eval,
+                (eval->nextTile + 2 * k) % tilesCount);
+        features->mobility[1 - mover][k] = tile_mobility(eval,
+                (eval->nextTile + 2 * k + 1) % tilesCount);
+    }
+}
+
+/* Returns the player to move in the evaluator's position. */
+int fitz_eval_next_player(const FitzEval* eval) {
+    return eval->nextPlayer;
+}
+
+/* Returns the index of the tile to be placed next in the evaluator's
+position. */
+int fitz_eval_next_tile(const FitzEval* eval) {
+    return eval->nextTile;
+}
+
+/* Returns the current monotonic time in milliseconds. Search budgets are
+measured with this clock, and the fitz program and server time their moves,
+timeouts and latencies with it too. */
+double fitz_now_millis(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+/* Returns the greatest common divisor of "a" and "b". */
+static long gcd(long a, long b) {
+    while (b != 0) {
+        long rest = a % b;
+        a = b;
+        b = rest;
+    }
+    return a;
+}
+
+/* Scores a legal move for the player to move: their mobility over their next
+tiles minus the other player's, once the move is made. Sets "*winning" if the
+other player would then be unable to place their tile. */
+static long score_move(FitzEval* eval, FitzMove move, Bool* winning) {
+    int mover = eval->nextPlayer;
+    FitzEvalFeatures features;
+    fitz_eval_place(eval, move);
+    fitz_eval_features(eval, &features);
+    fitz_eval_undo(eval);
+    long score = 0;
+    for (int k = 0; k < FITZ_EVAL_TILES; k++) {
+        score += features.mobility[mover][k] - features.mobility[1 - mover][k];
+    }
+    *winning = features.mobility[1 - mover][0] == 0;
+    return score;
+}
+
+/* Chooses a move for the player to move within "budgetMs" milliseconds,
+without making it. The first legal move found is kept as the best so far, so
+a move is always ready when time runs out; anchors are visited in a strided
+order that spreads a cut-short search over the whole board. Fails with
+FITZ_ERR_GAME_OVER if the next tile can't be placed. */
+FitzError fitz_eval_best_move(FitzEval* eval, int budgetMs, FitzMove* best) {
+    double deadline = fitz_now_millis() + budgetMs;
+    long anchorCount = eval->anchorCount;
+    const unsigned char* legal = eval->legal + eval->nextTile * anchorCount;
+    // a step near anchorCount / phi that is coprime to it visits every
+    // anchor once
+    long step = (long)(anchorCount * 0.6180339887) + 1;
+    while (gcd(anchorCount, step) != 1) {
+        step++;
+    }
+    Bool found = 0;
+    long bestScore = 0;
+    long anchor = 0;
+    for (long i = 0; i < anchorCount; i++) {
+        anchor = (anchor + step) % anchorCount;
+        int angles = legal[anchor];
+        for (int a = 0; a < 4 && angles != 0; a++) {
+            if (!(angles & (1 << a))) {
+                continue;
+            }
+            FitzMove move = {anchor / eval->anchorWidth - eval->margin,
+                    anchor % eval->anchorWidth - eval->margin, a * 90};
+            Bool winning;
+            long score = score_move(eval, move, &winning);
+            if (!found || score > bestScore) {
+                found = 1;
+                bestScore = score;
+                *best = move;
+            }
+            if (winning) {
+                *best = move;
+                return FITZ_OK;
+            }
+            if (fitz_now_millis() >= deadline) {
+                return FITZ_OK;
+            }
+        }
+        if (found && (i & 255) == 0 && fitz_now_millis() >= deadline) {
+            break;
+        }
+    }
+    return found ? FITZ_OK : FITZ_ERR_GAME_OVER;
+}
+
+/* Returns the number of legal placements (anchor and rotation) of the next
+tile for the player to move. */
+long fitz_eval_mobility(const FitzEval* eval) {
+    return tile_mobility(eval, eval->nextTile);
+}
+
+/* Finds the first legal placement of the next tile at or after "position",
+where placements are numbered anchor by anchor in row-major order and then
+by angle (position = ((row + margin) * (cols + 2 * margin) + col + margin) * 4
++ angle / 90).
+Stores it in "move" and returns its position, or -1 if there is none. Moves
+that are placed and undone in between don't disturb the numbering. */
+long fitz_eval_next_legal(const FitzEval* eval, long position,
+        FitzMove* move) {
+    const unsigned char* legal = eval->legal + eval->nextTile *
+            eval->anchorCount;
+    for (long anchor = position / 4; anchor < eval->anchorCount; anchor++) {
+        int angles = legal[anchor];
+        if (anchor == position / 4) {
+            // drop the rotations before the starting one
+            angles &= ~((1 << (position % 4)) - 1);
+        }
+        if (angles != 0) {
+            int a = 0;
+            while (!(angles & (1 << a))) {
+                a++;
+            }
+            move->row = anchor / eval->anchorWidth - eval->margin;
+            move->col = anchor % eval->anchorWidth - eval->margin;
+            move->angle = a * 90;
+            return anchor * 4 + a;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "events.h"
+
+/* Events describe a game without its boards, so that programs can follow it
+cheaply: a start event, one event per move (and per hint) and an end event.
+As JSON lines they are
+    {"event":"start","rows":R,"cols":C,"tiles":N,"next_tile":T,
+            "next_player":"*","players":["h","1"]}
+    {"event":"move","ply":P,"player":"#","tile":T,"row":R,"col":C,
+            "angle":A,"us":MICROSECONDS}
+    {"event":"hint", ...the fields of a move but "ply", for the move
+            suggested}
+    {"event":"end","winner":"*","reason":"game_over","plies":P}
+where the winner is null if a human player's input ended the game or a
+scripted move was illegal.
+In the binary stream each event is EVENT_RECORD_SIZE bytes: the kind
+('S', 'M', 'H' or 'E'), a player (0 for *, 1 for #), a small field, a zero
+byte and four 32-bit little-endian integers:
+    start: next player, 0, rows, columns, tile count, next tile
+    move or hint: player, angle / 90, tile, row, column, microseconds
+    end: winner (2 for none), reason (0 game over, 1 forfeit, 2 end of
+            input, 3 illegal scripted move), plies, 0, 0, 0 */
+
+static const char* endReasons[] = {"game_over", "forfeit", "end_of_input",
+        "illegal_move"};
+
+/* Parses an "--output=FORMAT" option (text, jsonl or binary) into "mode".
+Returns 0 if it isn't one. */
+Bool parse_output_mode(const char* arg, OutputMode* mode) {
+    if (strncmp(arg, "--output=", 9) != 0) {
+        return 0;
+    }
+    const char* format = arg + 9;
+    if (strcmp(format, "text") == 0) {
+        *mode = OUTPUT_TEXT;
+    } else if (strcmp(format, "jsonl") == 0) {
+        *mode = OUTPUT_JSONL;
+    } else if (strcmp(format, "binary") == 0) {
+        *mode = OUTPUT_BINARY;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+/* Writes "text" as a JSON string. */
+void write_json_string(const char* text, FILE* out) {
+    fputc('"', out);
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(out, "\\%c", *c);
+        } else if ((unsigned char)*c < 0x20) {
+            fprintf(out, "\\u%04x", *c);
+        } else {
+            fputc(*c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+/* Writes a binary event: its kind, player and small field, then four
+integers in little-endian order. */
+static void write_record(int kind, int player, int small, long a, long b,
+        long c, long d, FILE* out) {
+    unsigned char record[EVENT_RECORD_SIZE] = {0};
+    long values[4] = {a, b, c, d};
+    record[0] = kind;
+    record[1] = player;
+    record[2] = small;
+    for (int i = 0; i < 4; i++) {
+        uint32_t value = (uint32_t)values[i];
+        for (int byte = 0; byte < 4; byte++) {
+            record[4 + i * 4 + byte] = (value >> (8 * byte)) & 0xff;
+        }
+    }
+    fwrite(record, 1, EVENT_RECORD_SIZE, out);
+}
+
+/* Writes the start event of a game played by "pType1" and "pType2". */
+void emit_start(FitzGame* currentGame, char* pType1, char* pType2,
+        OutputMode mode, FILE* out) {
+    int rows = fitz_game_rows(currentGame);
+    int cols = fitz_game_cols(currentGame);
+    int tiles = fitz_tiles_count(fitz_game_tiles(currentGame));
+    int nextTile = fitz_game_next_tile(currentGame);
+    int nextPlayer = fitz_game_next_player(currentGame);
+    if (mode == OUTPUT_BINARY) {
+        write_record(EVENT_START, nextPlayer, 0, rows, cols, tiles, nextTile,
+                out);
+        return;
+    }
+    fprintf(out, "{\"event\":\"start\",\"rows\":%d,\"cols\":%d,\"tiles\":%d,"
+            "\"next_tile\":%d,\"next_player\":\"%c\",\"players\":[", rows,
+            cols, tiles, nextTile, "*#"[nextPlayer]);
+    write_json_string(pType1, out);
+    fputc(',', out);
+    write_json_string(pType2, out);
+    fputs("]}\n", out);
+}
+
+/* Writes a move event for the "ply"-th move of the game (or, if "kind" is
+EVENT_HINT, a hint event, which has no ply): "player" placing tile "tile" as
+"move", which took "micros" microseconds to choose. */
+void emit_move(int kind, long ply, int player, int tile, FitzMove move,
+        long micros, OutputMode mode, FILE* out) {
+    if (mode == OUTPUT_BINARY) {
+        write_record(kind, player, move.angle / 90, tile, move.row, move.col,
+                micros, out);
+        return;
+    }
+    if (kind == EVENT_HINT) {
+        fputs("{\"event\":\"hint\",", out);
+    } else {
+        fprintf(out, "{\"event\":\"move\",\"ply\":%ld,", ply);
+    }
+    fprintf(out, "\"player\":\"%c\",\"tile\":%d,\"row\":%d,\"col\":%d,"
+            "\"angle\":%d,\"us\":%ld}\n", "*#"[player], tile, move.row,
+            move.col, move.angle, micros);
+}
+
+/* Writes the end event of a game won by "winner" (-1 for nobody) after
+"plies" moves. */
+void emit_end(int winner, EndReason reason, long plies, OutputMode mode,
+        FILE* out) {
+    if (mode == OUTPUT_BINARY) {
+        write_record(EVENT_END, winner < 0 ? 2 : winner, reason, plies, 0, 0,
+                0, out);
+        return;
+    }
+    fputs("{\"event\":\"end\",\"winner\":", out);
+    if (winner < 0) {
+        fputs("null", out);
+    } else {
+        fprintf(out, "\"%c\"", "*#"[winner]);
+    }
+    fprintf(out, ",\"reason\":\"%s\",\"plies\":%ld}\n", endReasons[reason],
+            plies);
+}
@@ -0,0 +1,33 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include "head.h"
+
+// size of every event in the binary event stream
+#define EVENT_RECORD_SIZE 20
+
+// kinds of event, which are also the first byte of a binary event
+#define EVENT_START 'S'
+#define EVENT_MOVE 'M'
+#define EVENT_HINT 'H'
+#define EVENT_END 'E'
+
+// why a game ended, as reported in its end event
+typedef enum {
+    END_GAME_OVER,      // the player to move couldn't place their tile
+    END_FORFEIT,        // an engine failed or a human ran out of time
+    END_INPUT,          // a human player's input ended
+    END_SCRIPT          // a move from a move script was illegal
+} EndReason;
+
+//function prototypes
+Bool parse_output_mode(const char* arg, OutputMode* mode);
+void write_json_string(const char* text, FILE* out);
+void emit_start(FitzGame* currentGame, char* pType1, char* pType2,
+        OutputMode mode, FILE* out);
+void emit_move(int kind, long ply, int player, int tile, FitzMove move,
+        long micros, OutputMode mode, FILE* out);
+void emit_end(int winner, EndReason reason, long plies, OutputMode mode,
+        FILE* out);
+
+#endif
@@ -0,0 +1,393 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "export.h"
+#include "timing.h"
+
+/* A dataset is a file of positions from self-play games, for training
+evaluation models. Every part has a fixed size, so it can be streamed from
+the start or memory-mapped and read at random. It starts with a header:
+    magic "FITZDS1\0", tiles hash (8), rows (4), cols (4), tile count (4),
+    upcoming tiles per position (4), record size (4), board plane size (4),
+    games (8), seed (8), automated players A and B (1 each),
+    random opening moves (2), unused (4)
+followed by chunks, each a chunk header:
+    magic "FZCK", position count (4), number of the first position (8)
+and that many position records:
+    player to move (1), winner of the game (1), angle / 90 of the move made
+    (1), unused (1), row (2) and column (2) of the move, ply (4), game (4),
+    the indexes of the next EXPORT_UPCOMING tiles (4 each),
+    the cells of player * as a bit plane, then those of player #
+where cell (r, c) is bit (r * cols + c) % 64 of word (r * cols + c) / 64 of a
+plane, and a plane is a whole number of words. After the last chunk comes the
+index, one entry per chunk:
+    offset of the chunk (8), number of its first position (8), positions (8)
+and last a trailer:
+    magic "FITZIX1\0", offset of the index (8), chunks (8), positions (8)
+Numbers are in the machine's byte order. Chunks are written as workers fill
+them, so their order and the numbers of games' positions vary from run to
+run, but the records of each game don't. */
+
+#define DATASET_MAGIC "FITZDS1"
+#define CHUNK_MAGIC "FZCK"
+#define INDEX_MAGIC "FITZIX1"
+
+// what the workers share
+typedef struct {
+    const FitzTiles* tiles;
+    int rows;
+    int cols;
+    int bots[2];            // automated players making the moves
+    long randomPlies;       // random moves opening each game
+    uint64_t seed;
+    long games;
+    long nextGame;          // first game no worker has taken yet
+    int recordSize;
+    int planeWords;         // words in a bit plane of the board
+    FILE* out;
+    uint64_t offset;        // bytes written so far
+    uint64_t records;       // positions written so far
+    ExportChunk* index;
+    long chunkCount;
+    long chunkCapacity;
+    Bool failed;            // a write failed
+    pthread_mutex_t lock;
+} ExportJob;
+
+// a worker's chunk being filled
+typedef struct {
+    unsigned char* records;
+    long count;
+    long capacity;
+} ChunkBuffer;
+
+/* Writes a worker's positions out as the next chunk, adding it to the index,
+and empties the buffer. */
+static void write_chunk(ExportJob* job, ChunkBuffer* chunk) {
+    if (chunk->count == 0) {
+        return;
+    }
+    unsigned char header[EXPORT_CHUNK_HEADER_SIZE];
+    uint32_t count = chunk->count;
+    pthread_mutex_lock(&job->lock);
+    memcpy(header, CHUNK_MAGIC, 4);
+    memcpy(header + 4, &count, 4);
+    memcpy(header + 8, &job->records, 8);
+    size_t length = (size_t)chunk->count * job->recordSize;
+    if (fwrite(header, 1, EXPORT_CHUNK_HEADER_SIZE, job->out) !=
+            EXPORT_CHUNK_HEADER_SIZE ||
+            fwrite(chunk->records, 1, length, job->out) != length) {
+        job->failed = 1;
+    }
+    if (job->chunkCount == job->chunkCapacity) {
+        job->chunkCapacity *= 2;
+        job->index = realloc(job->index,
+                sizeof(ExportChunk) * job->chunkCapacity);
+    }
+    ExportChunk* entry = &job->index[job->chunkCount++];
+    entry->offset = job->offset;
+    entry->firstRecord = job->records;
+    entry->count = chunk->count;
+    job->offset += EXPORT_CHUNK_HEADER_SIZE + length;
+    job->records += chunk->count;
+    pthread_mutex_unlock(&job->lock);
+    chunk->count = 0;
+}
+
+/* Returns the next record of a chunk buffer, making room for it if needed. */
+static unsigned char* next_record(ChunkBuffer* chunk, int recordSize) {
+    if (chunk->count == chunk->capacity) {
+        chunk->capacity *= 2;
+        chunk->records = realloc(chunk->records,
+                (size_t)chunk->capacity * recordSize);
+    }
+    return chunk->records + (size_t)chunk->count++ * recordSize;
+}
+
+/* Fills the position part of "record" from a game: the player to move, the
+upcoming tiles and the board's bit planes. */
+static void record_position(const ExportJob* job, const FitzGame* game,
+        long ply, long gameNumber, unsigned char* record) {
+    memset(record, 0, job->recordSize);
+    record[0] = fitz_game_next_player(game);
+    uint32_t numbers[2 + EXPORT_UPCOMING] = {ply, gameNumber};
+    int tilesCount = fitz_tiles_count(job->tiles);
+    for (int k = 0; k < EXPORT_UPCOMING; k++) {
+        numbers[2 + k] = (fitz_game_next_tile(game) + k) % tilesCount;
+    }
+    memcpy(record + 8, numbers, sizeof(numbers));
+    uint64_t* planes = (uint64_t*)(record + EXPORT_RECORD_HEADER_SIZE);
+    const char* grid = fitz_game_grid(game);
+    long cell = 0;
+    for (int r = 0; r < job->rows; r++) {
+        const char* row = grid + r * (job->cols + 1);
+        for (int c = 0; c < job->cols; c++, cell++) {
+            if (row[c] != '.') {
+                planes[(row[c] == '#') * job->planeWords + cell / 64] |=
+                        (uint64_t)1 << (cell % 64);
+            }
+        }
+    }
+}
+
+/* Chooses a legal placement of the next tile uniformly at random, storing it
+in "move". Returns 0 if there is none, otherwise 1. */
+Bool random_legal_move(FitzGame* game, Random* random, FitzMove* move) {
+    FitzLegalMap map;
+    int tile = fitz_game_next_tile(game);
+    if (fitz_game_legal_map(game, &tile, 1, FITZ_ALL_ANGLES, &map) !=
+            FITZ_OK) {
+        return 0;
+    }
+    long total = 0;
+    for (int i = 0; i < map.count; i++) {
+        total += fitz_legal_map_count(&map, i);
+    }
+    Bool found = total > 0;
+    long k = found ? (long)random_below(random, total) : 0;
+    long mapWords = (long)map.wordsPerRow * map.height;
+    for (long w = 0; found && w < map.count * mapWords; w++) {
+        uint64_t bits = map.bits[w];
+        int count = __builtin_popcountll(bits);
+        if (k >= count) {
+            k -= count;
+            continue;
+        }
+        while (k-- > 0) {
+            bits &= bits - 1;
+        }
+        long anchor = w % mapWords;
+        move->row = anchor / map.wordsPerRow - map.margin;
+        move->col = anchor % map.wordsPerRow * 64 + __builtin_ctzll(bits) -
+                map.margin;
+        move->angle = w / mapWords * 90;
+        break;
+    }
+    fitz_legal_map_free(&map);
+    return found;
+}
+
+/* Makes move "ply" of a self-play game and stores it in "move": a random legal
+move for the first "randomPlies" moves, and then automated player bots[0]'s
+(for *) or bots[1]'s (for #) move. Returns 0 if the player to move can't place
+their tile, otherwise 1. */
+Bool self_play_move(FitzGame* game, Random* random, const int bots[2],
+        long ply, long randomPlies, FitzMove* move) {
+    if (ply < randomPlies) {
+        return random_legal_move(game, random, move) &&
+                fitz_game_play(game, *move) == FITZ_OK;
+    }
+    return fitz_game_auto_move(game, bots[fitz_game_next_player(game)],
+            move) == FITZ_OK;
+}
+
+/* Plays game number "gameNumber" of the export, adding its positions to the
+worker's chunk: a few random moves, then the automated players until the
+player to move can't place their tile. */
+static void play_export_game(ExportJob* job, long gameNumber,
+        ChunkBuffer* chunk) {
+    FitzGame* game;
+    if (fitz_game_new(job->tiles, job->rows, job->cols, &game) != FITZ_OK) {
+        return;
+    }
+    Random random = {job->seed + (uint64_t)gameNumber * EXPORT_GAME_SPACING,
+            0, 0};
+    long first = chunk->count;
+    for (long ply = 0; ; ply++) {
+        unsigned char* record = next_record(chunk, job->recordSize);
+        record_position(job, game, ply, gameNumber, record);
+        FitzMove move;
+        if (!self_play_move(game, &random, job->bots, ply, job->randomPlies,
+                &move)) {
+            // the final position has no move to learn from
+            chunk->count--;
+            break;
+        }
+        int16_t anchor[2] = {move.row, move.col};
+        record[2] = move.angle / 90;
+        memcpy(record + 4, anchor, 4);
+    }
+    // the player left to move has lost
+    unsigned char winner = 1 - fitz_game_next_player(game);
+    for (long i = first; i < chunk->count; i++) {
+        chunk->records[(size_t)i * job->recordSize + 1] = winner;
+    }
+    fitz_game_free(game);
+}
+
+/* Plays games off the job until none are left, writing their positions a
+chunk at a time. */
+static void* export_worker(void* arg) {
+    ExportJob* job = arg;
+    ChunkBuffer chunk;
+    chunk.capacity = EXPORT_CHUNK_RECORDS;
+    chunk.count = 0;
+    chunk.records = malloc((size_t)chunk.capacity * job->recordSize);
+    while (1) {
+        pthread_mutex_lock(&job->lock);
+        long gameNumber = job->nextGame++;
+        pthread_mutex_unlock(&job->lock);
+        if (gameNumber >= job->games) {
+            break;
+        }
+        play_export_game(job, gameNumber, &chunk);
+        if (chunk.count >= EXPORT_CHUNK_RECORDS) {
+            write_chunk(job, &chunk);
+        }
+    }
+    write_chunk(job, &chunk);
+    free(chunk.records);
+    return NULL;
+}
+
+/* Writes the dataset header for a job. */
+static void write_dataset_header(ExportJob* job) {
+    unsigned char header[EXPORT_HEADER_SIZE] = {0};
+    uint64_t tilesHash = fitz_tiles_hash(job->tiles);
+    int32_t sizes[6] = {job->rows, job->cols, fitz_tiles_count(job->tiles),
+            EXPORT_UPCOMING, job->recordSize, job->planeWords * 8};
+    int64_t games = job->games;
+    uint16_t randomPlies = job->randomPlies;
+    memcpy(header, DATASET_MAGIC, 8);
+    memcpy(header + 8, &tilesHash, 8);
+    memcpy(header + 16, sizes, sizeof(sizes));
+    memcpy(header + 40, &games, 8);
+    memcpy(header + 48, &job->seed, 8);
+    header[56] = job->bots[0];
+    header[57] = job->bots[1];
+    memcpy(header + 58, &randomPlies, 2);
+    if (fwrite(header, 1, EXPORT_HEADER_SIZE, job->out) !=
+            EXPORT_HEADER_SIZE) {
+        job->failed = 1;
+    }
+    job->offset = EXPORT_HEADER_SIZE;
+}
+
+/* Writes the index of a job's chunks and the trailer after the last chunk. */
+static void write_dataset_index(ExportJob* job) {
+    uint64_t indexOffset = job->offset;
+    for (long i = 0; i < job->chunkCount; i++) {
+        uint64_t entry[3] = {job->index[i].offset, job->index[i].firstRecord,
+                job->index[i].count};
+        if (fwrite(entry, 1, EXPORT_INDEX_ENTRY_SIZE, job->out) !=
+                EXPORT_INDEX_ENTRY_SIZE) {
+            job->failed = 1;
+        }
+    }
+    unsigned char trailer[EXPORT_TRAILER_SIZE];
+    uint64_t chunkCount = job->chunkCount;
+    memcpy(trailer, INDEX_MAGIC, 8);
+    memcpy(trailer + 8, &indexOffset, 8);
+    memcpy(trailer + 16, &chunkCount, 8);
+    memcpy(trailer + 24, &job->records, 8);
+    if (fwrite(trailer, 1, EXPORT_TRAILER_SIZE, job->out) !=
+            EXPORT_TRAILER_SIZE) {
+        job->failed = 1;
+    }
+}
+
+/* Prints the usage message of "fitz --export" and returns its status. */
+static int export_usage(void) {
+    fprintf(stderr, "Usage: fitz --export [-j threads] [--bots AB] "
+            "[--random plies] tilefile height width games seed outfile\n");
+    return 1;
+}
+
+/* Runs "fitz --export [-j threads] [--bots AB] [--random plies] tilefile
+height width games seed outfile": plays "games" games on height x width
+boards, each opened by "plies" random moves (by default EXPORT_DEFAULT_RANDOM)
+drawn from "seed" and finished by automated players A (for *) and B (for #),
+and writes every position with the move made in it and the game's winner to
+"outfile" ("-" for standard output) as a dataset. The games are shared out
+among the threads, one per processor by default; the time taken goes to
+standard error. Returns the program's exit status. */
+int run_export(char** args, int argCount) {
+    long threadCount = sysconf(_SC_NPROCESSORS_ONLN);
+    ExportJob job;
+    job.bots[0] = 1;
+    job.bots[1] = 2;
+    job.randomPlies = EXPORT_DEFAULT_RANDOM;
+    int used = 0;
+    while (used + 1 < argCount && args[used][0] == '-') {
+        if (strcmp(args[used], "-j") == 0) {
+            if (!parse_count(args[used + 1], 1, EXPORT_MAX_THREADS,
+                    &threadCount)) {
+                return export_usage();
+            }
+        } else if (strcmp(args[used], "--bots") == 0 &&
+                strlen(args[used + 1]) == 2 &&
+                strspn(args[used + 1], "12") == 2) {
+            job.bots[0] = args[used + 1][0] - '0';
+            job.bots[1] = args[used + 1][1] - '0';
+        } else if (strcmp(args[used], "--random") != 0 ||
+                !parse_count(args[used + 1], 0, 0xffff, &job.randomPlies)) {
+            return export_usage();
+        }
+        used += 2;
+    }
+    long rows, cols, games, seed;
+    if (argCount - used != 6 || threadCount < 1 ||
+            !parse_count(args[used + 1], 1, FITZ_MAX_DIMENSION, &rows) ||
+            !parse_count(args[used + 2], 1, FITZ_MAX_DIMENSION, &cols) ||
+            !parse_count(args[used + 3], 1, 0x7fffffffL, &games) ||
+            !parse_count(args[used + 4], 0, 0x7fffffffL, &seed)) {
+        return export_usage();
+    }
+    FitzTiles* tiles = load_tiles(args[used]);
+    const char* path = args[used + 5];
+    job.out = strcmp(path, "-") == 0 ? stdout : fopen(path, "wb");
+    if (job.out == NULL) {
+        fitz_tiles_free(tiles);
+        fprintf(stderr, "Unable to write dataset\n");
+        return 21;
+    }
+    job.tiles = tiles;
+    job.rows = (int)rows;
+    job.cols = (int)cols;
+    job.seed = (uint64_t)seed;
+    job.games = games;
+    job.nextGame = 0;
+    job.planeWords = (int)((rows * cols + 63) / 64);
+    job.recordSize = EXPORT_RECORD_HEADER_SIZE + 2 * 8 * job.planeWords;
+    job.records = 0;
+    job.chunkCount = 0;
+    job.chunkCapacity = 16;
+    job.index = malloc(sizeof(ExportChunk) * job.chunkCapacity);
+    job.failed = 0;
+    pthread_mutex_init(&job.lock, NULL);
+    if (threadCount > games) {
+        threadCount = games;
+    }
+    double start = fitz_now_millis();
+    write_dataset_header(&job);
+
+    pthread_t* threads = malloc(sizeof(pthread_t) * threadCount);
+    for (int i = 1; i < threadCount; i++) {
+        pthread_create(&threads[i], NULL, export_worker, &job);
+    }
+    export_worker(&job);
+    for (int i = 1; i < threadCount; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    write_dataset_index(&job);
+    if ((job.out == stdout ? fflush(stdout) : fclose(job.out)) != 0) {
+        job.failed = 1;
+    }
+    double seconds = (fitz_now_millis() - start) / 1000;
+    fprintf(stderr, "%lu positions from %ld games in %.3f s "
+            "(%.0f positions/s, %ld threads)\n",
+            (unsigned long)job.records, games, seconds,
+            seconds > 0 ? job.records / seconds : 0.0, threadCount);
+
+    free(threads);
+    free(job.index);
+    pthread_mutex_destroy(&job.lock);
+    fitz_tiles_free(tiles);
+    if (job.failed) {
+        fprintf(stderr, "Unable to write dataset\n");
+        return 21;
+    }
+    return 0;
+}
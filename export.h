@@ -0,0 +1,37 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <stdint.h>
+#include "head.h"
+#include "generate.h"
+
+// upcoming tiles recorded with each position, starting with the next one
+#define EXPORT_UPCOMING 4
+// random moves opening each game unless "--random" says otherwise
+#define EXPORT_DEFAULT_RANDOM 4
+// spacing of the games' random sequences (BATCH_GAME_SPACING in batch.c)
+#define EXPORT_GAME_SPACING 0xd1b54a32d192ed03ULL
+// positions a worker gathers before writing them out as a chunk
+#define EXPORT_CHUNK_RECORDS 4096
+#define EXPORT_MAX_THREADS 256
+// sizes of the parts of a dataset file (see export.c)
+#define EXPORT_HEADER_SIZE 64
+#define EXPORT_CHUNK_HEADER_SIZE 16
+#define EXPORT_RECORD_HEADER_SIZE 32
+#define EXPORT_INDEX_ENTRY_SIZE 24
+#define EXPORT_TRAILER_SIZE 32
+
+// a chunk of the dataset as listed in its index
+typedef struct {
+    uint64_t offset;        // of the chunk header from the start of the file
+    uint64_t firstRecord;   // number of the chunk's first position
+    uint64_t count;         // positions in the chunk
+} ExportChunk;
+
+//function prototypes
+int run_export(char** args, int argCount);
+Bool random_legal_move(FitzGame* game, Random* random, FitzMove* move);
+Bool self_play_move(FitzGame* game, Random* random, const int bots[2],
+        long ply, long randomPlies, FitzMove* move);
+
+#endif
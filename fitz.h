@@ -0,0 +1,207 @@
+#ifndef FITZ_H
+#define FITZ_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* libfitz: the fitz game engine as a reentrant library. A FitzTiles handle is
+immutable once loaded and may be shared by any number of games (and threads);
+a FitzGame handle holds one game and must only be used by one thread at a
+time. A FitzCache may be shared by any number of games, threads and processes.
+No function exits the process - failures are reported as FitzError
+codes. */
+
+// the largest board height or width
+#define FITZ_MAX_DIMENSION 999
+// the largest tile height and width
+#define FITZ_MAX_TILE_SIZE 8
+
+// error codes; those shared with the fitz program are its exit statuses
+typedef enum {
+    FITZ_OK = 0,
+    FITZ_ERR_TILE_ACCESS = 2,
+    FITZ_ERR_TILE_CONTENTS = 3,
+    FITZ_ERR_PLAYER_TYPE = 4,
+    FITZ_ERR_DIMENSIONS = 5,
+    FITZ_ERR_SAVE_ACCESS = 6,
+    FITZ_ERR_SAVE_CONTENTS = 7,
+    FITZ_ERR_INVALID_MOVE = 20,     // malformed, or the tile doesn't fit
+    FITZ_ERR_SAVE_WRITE = 21,       // the save file couldn't be written
+    FITZ_ERR_GAME_OVER = 22,        // the next tile can't be placed anywhere
+    FITZ_ERR_ARGUMENT = 23,         // e.g. a tile index out of range
+    FITZ_ERR_BOOK_ACCESS = 24,
+    FITZ_ERR_BOOK_CONTENTS = 25,    // not a book, or made for other tiles
+    FITZ_ERR_BOOK_WRITE = 26,
+    FITZ_ERR_CACHE_ACCESS = 29,
+    FITZ_ERR_CACHE_CONTENTS = 30    // not a position cache
+} FitzError;
+
+// a placement: the board position of the tile's centre and the clockwise
+// rotation (0, 90, 180 or 270)
+typedef struct {
+    int row;
+    int col;
+    int angle;
+} FitzMove;
+
+// bit for a rotation in an "angles" set, e.g. FITZ_ANGLE_BIT(90)
+#define FITZ_ANGLE_BIT(angle) (1 << ((angle) / 90))
+#define FITZ_ALL_ANGLES 15
+
+// legal anchors of one or more tile rotations. Each bitmap covers the anchors
+// [-margin, rows + margin) x [-margin, cols + margin), where the margin is half
+// the tile size: anchor (r, c) is bit (c + margin) % 64 of word
+// (r + margin) * wordsPerRow + (c + margin) / 64 of the bitmap.
+typedef struct {
+    int margin;         // how far anchors reach off the board
+    int height;         // rows + 2 * margin
+    int width;          // cols + 2 * margin
+    int wordsPerRow;    // (width + 63) / 64
+    int count;          // number of bitmaps
+    uint64_t* bits;     // the bitmaps, one after the other
+} FitzLegalMap;
+
+// number of upcoming tiles per player whose mobility is evaluated
+#define FITZ_EVAL_TILES 4
+
+// features of a position kept up to date by an evaluator
+typedef struct {
+    int nextPlayer;         // the player to move
+    long emptyCells;        // cells not covered by any tile
+    long reachableCells;    // empty cells some tile can still be placed on
+    // legal placements (anchor and rotation) of the k-th tile player p will
+    // place from now on, as mobility[p][k]
+    long mobility[2][FITZ_EVAL_TILES];
+} FitzEvalFeatures;
+
+// a position and the move an opening book gives for it
+typedef struct {
+    uint64_t key;           // see fitz_game_position_key()
+    long emptyCells;        // empty cells of the position's board
+    FitzMove move;
+} FitzBookEntry;
+
+// totals over the games a batch engine has played
+typedef struct {
+    long games;
+    long wins[2];       // games won by * and by #
+    long plies;         // moves made in all the games
+} FitzBatchResults;
+
+// who makes a player's moves when a game is run with fitz_game_step()
+typedef enum {
+    FITZ_PLAYER_EXTERNAL = 0,   // the caller: a human or an external engine
+    FITZ_PLAYER_AUTO_1 = 1,     // automated player 1
+    FITZ_PLAYER_AUTO_2 = 2,     // automated player 2
+    FITZ_PLAYER_SEARCH = 3      // automated player 3 (fitz_game_best_move())
+} FitzPlayerKind;
+
+// what a call to fitz_game_step() did
+typedef enum {
+    FITZ_STEP_NEED_INPUT,   // an external player is to move: pass their move
+    FITZ_STEP_MOVED,        // one move was made
+    FITZ_STEP_GAME_OVER     // the player to move can't place their tile (or
+                            // an automated player failed to move)
+} FitzStepStatus;
+
+// the outcome of a call to fitz_game_step()
+typedef struct {
+    FitzStepStatus status;
+    int player;         // who moved or is to move, or once over who won
+    int tile;           // the tile placed or to be placed
+    FitzMove move;      // the move made
+    // FITZ_ERR_INVALID_MOVE if the input was rejected, or why an automated
+    // player failed to move and so lost
+    FitzError error;
+} FitzStep;
+
+typedef struct FitzTiles FitzTiles;
+typedef struct FitzGame FitzGame;
+typedef struct FitzEval FitzEval;
+typedef struct FitzBook FitzBook;
+typedef struct FitzCache FitzCache;
+typedef struct FitzBatch FitzBatch;
+
+const char* fitz_error_message(FitzError error);
+
+FitzError fitz_tiles_load(const char* path, FitzTiles** tilesPtr);
+void fitz_tiles_free(FitzTiles* tiles);
+int fitz_tiles_count(const FitzTiles* tiles);
+int fitz_tiles_size(const FitzTiles* tiles);
+void fitz_tiles_print(const FitzTiles* tiles, int index, FILE* out);
+void fitz_tiles_display(const FitzTiles* tiles, FILE* out);
+
+FitzError fitz_game_new(const FitzTiles* tiles, int rows, int cols,
+        FitzGame** gamePtr);
+FitzError fitz_game_load(const FitzTiles* tiles, const char* path,
+        FitzGame** gamePtr);
+FitzError fitz_game_copy(const FitzGame* game, FitzGame** copyPtr);
+FitzError fitz_game_save(const FitzGame* game, const char* path);
+void fitz_game_free(FitzGame* game);
+const FitzTiles* fitz_game_tiles(const FitzGame* game);
+int fitz_game_rows(const FitzGame* game);
+int fitz_game_cols(const FitzGame* game);
+int fitz_game_next_player(const FitzGame* game);
+int fitz_game_next_tile(const FitzGame* game);
+const char* fitz_game_grid(const FitzGame* game);
+void fitz_game_print(const FitzGame* game, FILE* out);
+int fitz_game_last_move(const FitzGame* game, int* row, int* col);
+int fitz_game_over(const FitzGame* game);
+FitzError fitz_game_play(FitzGame* game, FitzMove move);
+FitzError fitz_game_auto_move(FitzGame* game, int automatedPlayer,
+        FitzMove* move);
+
+FitzError fitz_game_set_players(FitzGame* game, FitzPlayerKind player0,
+        FitzPlayerKind player1, int searchMs);
+FitzStepStatus fitz_game_step(FitzGame* game, const FitzMove* input,
+        FitzStep* step);
+
+FitzError fitz_parse_move(const char* input, FitzMove* move);
+
+FitzError fitz_game_legal_map(const FitzGame* game, const int* tileIndexes,
+        int tileCount, int angles, FitzLegalMap* map);
+int fitz_legal_map_test(const FitzLegalMap* map, int index, int row, int col);
+long fitz_legal_map_count(const FitzLegalMap* map, int index);
+void fitz_legal_map_free(FitzLegalMap* map);
+
+FitzError fitz_eval_new(const FitzGame* game, FitzEval** evalPtr);
+void fitz_eval_free(FitzEval* eval);
+int fitz_eval_is_legal(const FitzEval* eval, FitzMove move);
+FitzError fitz_eval_place(FitzEval* eval, FitzMove move);
+FitzError fitz_eval_undo(FitzEval* eval);
+void fitz_eval_features(const FitzEval* eval, FitzEvalFeatures* features);
+int fitz_eval_next_player(const FitzEval* eval);
+int fitz_eval_next_tile(const FitzEval* eval);
+long fitz_eval_mobility(const FitzEval* eval);
+long fitz_eval_next_legal(const FitzEval* eval, long position,
+        FitzMove* move);
+FitzError fitz_eval_best_move(FitzEval* eval, int budgetMs, FitzMove* best);
+FitzError fitz_game_prepare_search(FitzGame* game);
+FitzError fitz_game_best_move(FitzGame* game, int budgetMs, FitzMove* best);
+double fitz_now_millis(void);
+
+uint64_t fitz_tiles_hash(const FitzTiles* tiles);
+uint64_t fitz_game_position_key(const FitzGame* game);
+void fitz_book_entry(const FitzGame* game, FitzMove move,
+        FitzBookEntry* entry);
+FitzError fitz_book_write(const char* path, const FitzTiles* tiles, int rows,
+        int cols, const FitzBookEntry* entries, long count);
+FitzError fitz_book_open(const FitzTiles* tiles, const char* path,
+        FitzBook** bookPtr);
+void fitz_book_free(FitzBook* book);
+long fitz_book_count(const FitzBook* book);
+int fitz_book_lookup(const FitzBook* book, const FitzGame* game,
+        FitzMove* move);
+void fitz_game_set_book(FitzGame* game, const FitzBook* book);
+
+FitzError fitz_cache_open(const char* path, FitzCache** cachePtr);
+void fitz_cache_free(FitzCache* cache);
+void fitz_game_set_cache(FitzGame* game, FitzCache* cache);
+
+FitzError fitz_batch_new(const FitzTiles* tiles, int rows, int cols,
+        int lanes, const int bots[2], int randomPlies, uint64_t seed,
+        FitzBatch** batchPtr);
+void fitz_batch_free(FitzBatch* batch);
+void fitz_batch_run(FitzBatch* batch, long games, FitzBatchResults* results);
+
+#endif
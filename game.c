@@ -0,0 +1,459 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "internal.h"
+
+/* Returns the message the fitz program prints for an error code. */
+const char* fitz_error_message(FitzError error) {
+    switch (error) {
+        case FITZ_OK:
+            return "Success";
+        case FITZ_ERR_TILE_ACCESS:
+            return "Can't access tile file";
+        case FITZ_ERR_TILE_CONTENTS:
+            return "Invalid tile file contents";
+        case FITZ_ERR_PLAYER_TYPE:
+            return "Invalid player type";
+        case FITZ_ERR_DIMENSIONS:
+            return "Invalid dimensions";
+        case FITZ_ERR_SAVE_ACCESS:
+            return "Can't access save file";
+        case FITZ_ERR_SAVE_CONTENTS:
+            return "Invalid save file contents";
+        case FITZ_ERR_INVALID_MOVE:
+            return "Invalid move";
+        case FITZ_ERR_SAVE_WRITE:
+            return "Unable to save game";
+        case FITZ_ERR_GAME_OVER:
+            return "Game over";
+        case FITZ_ERR_ARGUMENT:
+            return "Invalid argument";
+        case FITZ_ERR_BOOK_ACCESS:
+            return "Can't access opening book";
+        case FITZ_ERR_BOOK_CONTENTS:
+            return "Invalid opening book contents";
+        case FITZ_ERR_BOOK_WRITE:
+            return "Unable to write opening book";
+        case FITZ_ERR_CACHE_ACCESS:
+            return "Can't access position cache";
+        case FITZ_ERR_CACHE_CONTENTS:
+            return "Invalid position cache contents";
+        default:
+            return "Unknown error";
+    }
+}
+
+/* Wraps a board in a new game handle, with no moves recorded yet. */
+static FitzGame* wrap_game(const FitzTiles* tiles, char* grid, int nextTile,
+        int nextPlayer, int rows, int cols) {
+    FitzGame* game = malloc(sizeof(FitzGame));
+    game->state.grid = grid;
+    game->state.nextTile = nextTile;
+    game->state.nextPlayer = nextPlayer;
+    game->state.rows = rows;
+    game->state.cols = cols;
+    game->state.margin = tiles->margin;
+    game->state.emptyCounts = new_empty_counts(grid, rows, cols);
+    new_free_rows(&game->state);
+    game->state.pyramid = new_pyramid(&game->state);
+    game->state.boardHash = board_hash(&game->state);
+    game->library = tiles;
+    game->recentPlays = new_recent_plays();
+    game->eval = NULL;
+    game->book = NULL;
+    game->players[0] = FITZ_PLAYER_EXTERNAL;
+    game->players[1] = FITZ_PLAYER_EXTERNAL;
+    game->searchMs = STEP_SEARCH_MS;
+    game->over = -1;
+    game->cache = NULL;
+    game->keyBase = tiles->hash;
+    int dimensions[2] = {rows, cols};
+    for (int i = 0; i < 2; i++) {
+        game->keyBase = (game->keyBase ^ (uint64_t)dimensions[i]) *
+                1099511628211ULL;
+    }
+    return game;
+}
+
+/* Starts a new game on an empty board of the given dimensions, with player *
+to place the first tile of "tiles". */
+FitzError fitz_game_new(const FitzTiles* tiles, int rows, int cols,
+        FitzGame** gamePtr) {
+    if (rows > FITZ_MAX_DIMENSION || rows < 1 || cols > FITZ_MAX_DIMENSION ||
+            cols < 1) {
+        return FITZ_ERR_DIMENSIONS;
+    }
+    *gamePtr = wrap_game(tiles, new_grid(rows, cols), 0, 0, rows, cols);
+    return FITZ_OK;
+}
+
+/* Resumes a game from the save file at "path". */
+FitzError fitz_game_load(const FitzTiles* tiles, const char* path,
+        FitzGame** gamePtr) {
+    FILE* savedGame = fopen(path, "r");
+    if (savedGame == NULL) {
+        return FITZ_ERR_SAVE_ACCESS;
+    }
+    char* grid = read_file(savedGame, tiles->tilesCount);
+    if (grid == NULL) {
+        fclose(savedGame);
+        return FITZ_ERR_SAVE_CONTENTS;
+    }
+    int* parameters = read_parameters(savedGame);
+    *gamePtr = wrap_game(tiles, grid, parameters[0], parameters[1],
+            parameters[2], parameters[3]);
+    free(parameters);
+    fclose(savedGame);
+    return FITZ_OK;
+}
+
+/* Copies a game's position (its board, the tile and player to move and the
+last moves, which automated players and viewports start from) into a new game
+handle. The players, book, cache and search of the game are not copied. */
+FitzError fitz_game_copy(const FitzGame* game, FitzGame** copyPtr) {
+    const Game* state = &game->state;
+    long length = (long)state->rows * (state->cols + 1);
+    char* grid = malloc(sizeof(char) * length);
+    memcpy(grid, state->grid, length);
+    FitzGame* copy = wrap_game(game->library, grid, state->nextTile,
+            state->nextPlayer, state->rows, state->cols);
+    for (int i = 0; i < 3; i++) {
+        copy->recentPlays[i][0] = game->recentPlays[i][0];
+        copy->recentPlays[i][1] = game->recentPlays[i][1];
+    }
+    *copyPtr = copy;
+    return FITZ_OK;
+}
+
+/* Writes a game to the save file at "path". */
+FitzError fitz_game_save(const FitzGame* game, const char* path) {
+    if (save_game(game->state, path) == 1) {
+        return FITZ_ERR_SAVE_WRITE;
+    }
+    return FITZ_OK;
+}
+
+/* Frees a game. Its tile library is left alone. */
+void fitz_game_free(FitzGame* game) {
+    free(game->state.grid);
+    free(game->state.emptyCounts);
+    free(game->state.freeRows);
+    free_pyramid(game->state.pyramid);
+    free_mem_recent_plays(game->recentPlays);
+    if (game->eval != NULL) {
+        fitz_eval_free(game->eval);
+    }
+    free(game);
+}
+
+/* Returns the tile library a game is played with. */
+const FitzTiles* fitz_game_tiles(const FitzGame* game) {
+    return game->library;
+}
+
+/* Returns the number of rows of a game's board. */
+int fitz_game_rows(const FitzGame* game) {
+    return game->state.rows;
+}
+
+/* Returns the number of columns of a game's board. */
+int fitz_game_cols(const FitzGame* game) {
+    return game->state.cols;
+}
+
+/* Returns the player to move: 0 for * and 1 for #. */
+int fitz_game_next_player(const FitzGame* game) {
+    return game->state.nextPlayer;
+}
+
+/* Returns the index of the tile to be placed next. */
+int fitz_game_next_tile(const FitzGame* game) {
+    return game->state.nextTile;
+}
+
+/* Returns a game's board: "rows" lines of "cols" characters ('.', '*' or '#'),
+each followed by '\n'. */
+const char* fitz_game_grid(const FitzGame* game) {
+    return game->state.grid;
+}
+
+/* Stores the anchor of the most recent move (by either player) in "row" and
+"col". Returns 0 if no move has been made in this game yet, otherwise 1. */
+int fitz_game_last_move(const FitzGame* game, int* row, int* col) {
+    const int* last = game->recentPlays[2];
+    if (last[0] == -10 && last[1] == -10) {
+        return 0;
+    }
+    *row = last[0];
+    *col = last[1];
+    return 1;
+}
+
+/* Writes a game's board to "out". */
+void fitz_game_print(const FitzGame* game, FILE* out) {
+    print_grid(game->state, out);
+}
+
+// answer cached for an automated player that can't place its tile
+#define NO_MOVE ((uint64_t)1 << 40)
+
+/* Packs a move into a position cache answer. */
+static uint64_t move_value(FitzMove move) {
+    return (uint16_t)move.row | (uint64_t)(uint16_t)move.col << 16 |
+            (uint64_t)(move.angle / 90) << 32;
+}
+
+/* Unpacks a move from a position cache answer. */
+static FitzMove value_move(uint64_t value) {
+    FitzMove move;
+    move.row = (int16_t)(value & 0xFFFF);
+    move.col = (int16_t)(value >> 16 & 0xFFFF);
+    move.angle = (int)(value >> 32 & 3) * 90;
+    return move;
+}
+
+/* Checks whether the player to move can't place their tile anywhere, which
+ends the game in the other player's favour. The game's position cache is
+asked first, and told the answer if it didn't have it. Returns 1 if yes,
+otherwise 0. */
+int fitz_game_over(const FitzGame* game) {
+    if (game->cache == NULL) {
+        return game_over(game->state, game->library);
+    }
+    uint64_t key = position_query_key(game, QUERY_GAME_OVER);
+    uint64_t value;
+    if (cache_lookup(game->cache, key, &value)) {
+        return value == 1;
+    }
+    int over = game_over(game->state, game->library);
+    cache_store(game->cache, key, over);
+    return over;
+}
+
+/* Hands the turn to the other player and moves on to the next tile. */
+static void advance_turn(FitzGame* game) {
+    game->state.nextPlayer = (game->state.nextPlayer + 1) % 2;
+    game->state.nextTile = (game->state.nextTile + 1) %
+            game->library->tilesCount;
+    game->over = -1;
+}
+
+/* Places the next tile for the player to move and passes the turn on. */
+FitzError fitz_game_play(FitzGame* game, FitzMove move) {
+    Game* state = &game->state;
+    if (move.angle < 0 || move.angle > 270 || move.angle % 90 != 0) {
+        return FITZ_ERR_INVALID_MOVE;
+    }
+    const TileShape* shape = &game->library->shapes[state->nextTile * 4 +
+            move.angle / 90];
+    if (!tile_fits(state, shape, move.row, move.col)) {
+        return FITZ_ERR_INVALID_MOVE;
+    }
+    put_tile(state, shape, state->nextPlayer, move.row, move.col);
+    record_play(game->recentPlays, state->nextPlayer, move.row, move.col);
+    if (game->eval != NULL) {
+        fitz_eval_place(game->eval, move);
+    }
+    advance_turn(game);
+    return FITZ_OK;
+}
+
+/* Lets automated player 1 or 2 choose and make its move as in
+automated_move_1() or automated_move_2(), storing the move in "move". The
+player's choice depends only on the position and where its scan starts, so
+that is what the game's position cache is asked. Returns 1 if the tile can't
+be placed anywhere, otherwise 0. */
+static int automated_move(FitzGame* game, int automatedPlayer,
+        FitzMove* move) {
+    Game* state = &game->state;
+    int (*player)(Game*, const FitzTiles*, int**, FitzMove*) =
+            automatedPlayer == 1 ? automated_move_1 : automated_move_2;
+    if (game->cache == NULL) {
+        return player(state, game->library, game->recentPlays, move);
+    }
+    int r, c;
+    if (automatedPlayer == 1) {
+        a1_assign_initial_values(state, game->recentPlays, &r, &c);
+    } else {
+        a2_assign_initial_values(state, game->recentPlays, &r, &c);
+    }
+    uint64_t key = position_query_key(game, QUERY_AUTO_MOVE |
+            automatedPlayer << 8 | (uint64_t)(uint16_t)r << 16 |
+            (uint64_t)(uint16_t)c << 32);
+    uint64_t value;
+    if (cache_lookup(game->cache, key, &value)) {
+        if (value == NO_MOVE) {
+            return 1;
+        }
+        FitzMove cached = value_move(value);
+        const TileShape* shape = &game->library->shapes[state->nextTile * 4 +
+                cached.angle / 90];
+        // an answer that doesn't fit can only come from a damaged cache
+        if (tile_fits(state, shape, cached.row, cached.col)) {
+            put_tile(state, shape, state->nextPlayer, cached.row,
+                    cached.col);
+            record_play(game->recentPlays, state->nextPlayer, cached.row,
+                    cached.col);
+            *move = cached;
+            return 0;
+        }
+    }
+    int result = player(state, game->library, game->recentPlays, move);
+    cache_store(game->cache, key, result == 1 ? NO_MOVE : move_value(*move));
+    return result;
+}
+
+/* Lets automated player 1 or 2 choose and make the move for the player to
+move, storing the move in "move". */
+FitzError fitz_game_auto_move(FitzGame* game, int automatedPlayer,
+        FitzMove* move) {
+    if (automatedPlayer != 1 && automatedPlayer != 2) {
+        return FITZ_ERR_PLAYER_TYPE;
+    }
+    if (automated_move(game, automatedPlayer, move) == 1) {
+        return FITZ_ERR_GAME_OVER;
+    }
+    if (game->eval != NULL) {
+        fitz_eval_place(game->eval, *move);
+    }
+    advance_turn(game);
+    return FITZ_OK;
+}
+
+/* Sets who makes each player's moves when the game is run with
+fitz_game_step(), and how long automated player 3 searches for. Until this is
+called both players are external. */
+FitzError fitz_game_set_players(FitzGame* game, FitzPlayerKind player0,
+        FitzPlayerKind player1, int searchMs) {
+    if (player0 < FITZ_PLAYER_EXTERNAL || player0 > FITZ_PLAYER_SEARCH ||
+            player1 < FITZ_PLAYER_EXTERNAL || player1 > FITZ_PLAYER_SEARCH) {
+        return FITZ_ERR_PLAYER_TYPE;
+    }
+    if (searchMs < 1) {
+        return FITZ_ERR_ARGUMENT;
+    }
+    game->players[0] = player0;
+    game->players[1] = player1;
+    game->searchMs = searchMs;
+    return FITZ_OK;
+}
+
+/* Advances a game by at most one move, so that a caller can drive any number
+of games from its own loop without blocking. If an automated player is to
+move, it moves and "input" is ignored. If an external player is to move,
+"input" is their move: it is made if it is legal, and otherwise (or if it is
+NULL) the game waits for input. Whether the game is over is worked out once
+per position, however often a waiting game is stepped. If an automated player
+fails to move, the game is over, the other player has won and the failure is
+in "step->error". Describes what happened in "step" and returns its status. */
+FitzStepStatus fitz_game_step(FitzGame* game, const FitzMove* input,
+        FitzStep* step) {
+    Game* state = &game->state;
+    int player = state->nextPlayer;
+    step->player = player;
+    step->tile = state->nextTile;
+    step->error = FITZ_OK;
+    if (game->over == -1) {
+        game->over = fitz_game_over(game);
+    }
+    if (game->over) {
+        step->player = 1 - player;
+        step->status = FITZ_STEP_GAME_OVER;
+        return step->status;
+    }
+    FitzPlayerKind kind = game->players[player];
+    step->status = FITZ_STEP_MOVED;
+    if (kind == FITZ_PLAYER_EXTERNAL) {
+        if (input == NULL) {
+            step->status = FITZ_STEP_NEED_INPUT;
+        } else if (fitz_game_play(game, *input) != FITZ_OK) {
+            step->error = FITZ_ERR_INVALID_MOVE;
+            step->status = FITZ_STEP_NEED_INPUT;
+        } else {
+            step->move = *input;
+        }
+    } else if (kind == FITZ_PLAYER_SEARCH) {
+        step->error = fitz_game_best_move(game, game->searchMs, &step->move);
+        if (step->error == FITZ_OK) {
+            step->error = fitz_game_play(game, step->move);
+        }
+    } else {
+        step->error = fitz_game_auto_move(game, kind, &step->move);
+    }
+    if (step->error != FITZ_OK && kind != FITZ_PLAYER_EXTERNAL) {
+        // the automated player failed to move, so it has lost
+        game->over = 1;
+        step->player = 1 - player;
+        step->status = FITZ_STEP_GAME_OVER;
+    }
+    return step->status;
+}
+
+/* Parses a human player's "row column rotate" input into a move. */
+FitzError fitz_parse_move(const char* input, FitzMove* move) {
+    int* result = get_human_input(input);
+    if (result == NULL) {
+        return FITZ_ERR_INVALID_MOVE;
+    }
+    move->row = result[0];
+    move->col = result[1];
+    move->angle = result[2];
+    free(result);
+    return FITZ_OK;
+}
+
+/* Builds the evaluator that fitz_game_best_move() searches with, so that later
+searches don't pay for it. The evaluator then follows every move made in the
+game. */
+FitzError fitz_game_prepare_search(FitzGame* game) {
+    if (game->eval == NULL) {
+        return fitz_eval_new(game, &game->eval);
+    }
+    return FITZ_OK;
+}
+
+/* Chooses a move for the player to move within about "budgetMs" milliseconds
+(see fitz_eval_best_move()), without making it. A move from the game's
+opening book, or one found by an earlier search as long in its position
+cache, is taken without searching. */
+FitzError fitz_game_best_move(FitzGame* game, int budgetMs, FitzMove* best) {
+    FitzError error = fitz_game_prepare_search(game);
+    if (error != FITZ_OK) {
+        return error;
+    }
+    if (game->book != NULL && fitz_book_lookup(game->book, game, best) &&
+            fitz_eval_is_legal(game->eval, *best)) {
+        return FITZ_OK;
+    }
+    if (game->cache == NULL) {
+        return fitz_eval_best_move(game->eval, budgetMs, best);
+    }
+    uint64_t key = position_query_key(game, QUERY_SEARCH |
+            (uint64_t)budgetMs << 8);
+    uint64_t value;
+    if (cache_lookup(game->cache, key, &value) && value != NO_MOVE) {
+        *best = value_move(value);
+        if (fitz_eval_is_legal(game->eval, *best)) {
+            return FITZ_OK;
+        }
+    }
+    error = fitz_eval_best_move(game->eval, budgetMs, best);
+    if (error == FITZ_OK) {
+        cache_store(game->cache, key, move_value(*best));
+    }
+    return error;
+}
+
+/* Sets the opening book fitz_game_best_move() consults (NULL for none). The
+book must outlive the game or be replaced first. */
+void fitz_game_set_book(FitzGame* game, const FitzBook* book) {
+    game->book = book;
+}
+
+/* Sets the position cache that fitz_game_over(), fitz_game_step(),
+fitz_game_auto_move() and fitz_game_best_move() ask before working anything
+out, and tell what they work out (NULL for none). The cache must outlive the
+game or be replaced first. */
+void fitz_game_set_cache(FitzGame* game, FitzCache* cache) {
+    game->cache = cache;
+}
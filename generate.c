@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "generate.h"
+
+/* Returns the next number of a splitmix64 sequence. */
+uint64_t next_random(Random* random) {
+    uint64_t z = (random->state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* Returns a random number from 0 up to (but excluding) "bound". */
+uint64_t random_below(Random* random, uint64_t bound) {
+    return next_random(random) % bound;
+}
+
+/* Returns "count" (at most 32) random bits, taking them from a whole random
+number at a time so that small choices are cheap. */
+unsigned random_bits(Random* random, int count) {
+    if (random->bitsLeft < count) {
+        random->bits = next_random(random);
+        random->bitsLeft = 64;
+    }
+    unsigned result = random->bits & ((1ULL << count) - 1);
+    random->bits >>= count;
+    random->bitsLeft -= count;
+    return result;
+}
+
+/* Makes room for "length" more bytes in the output buffer, writing out what
+it holds if needed. */
+void output_reserve(OutputBuffer* output, size_t length) {
+    if (output->length + length > GENERATE_BUFFER_SIZE) {
+        if (fwrite(output->data, 1, output->length, output->out) !=
+                output->length) {
+            output->failed = 1;
+        }
+        output->length = 0;
+    }
+}
+
+/* Fills "tile" (30 characters, as in a tile file) with a random polyomino of
+1 to "maxCells" cells, grown from the centre by adding a random free
+neighbour of the cells so far at each step. */
+void generate_tile(Random* random, int maxCells, char* tile) {
+    // cells are numbered row * 5 + col; a bit set per cell
+    static uint32_t neighbours[25];
+    if (neighbours[0] == 0) {
+        for (int i = 0; i < 25; i++) {
+            int row = i / 5;
+            int col = i % 5;
+            neighbours[i] = (row > 0 ? 1u << (i - 5) : 0) |
+                    (row < 4 ? 1u << (i + 5) : 0) |
+                    (col > 0 ? 1u << (i - 1) : 0) |
+                    (col < 4 ? 1u << (i + 1) : 0);
+        }
+    }
+    int cells = 1 + random_below(random, maxCells);
+    uint32_t grown = 1u << 12;
+    uint32_t frontier = neighbours[12];
+    for (int count = 1; count < cells; count++) {
+        // the k-th free neighbour, for a random k
+        int k = random_below(random, __builtin_popcount(frontier));
+        uint32_t candidates = frontier;
+        while (k-- > 0) {
+            candidates &= candidates - 1;
+        }
+        int cell = __builtin_ctz(candidates);
+        grown |= 1u << cell;
+        frontier = (frontier | neighbours[cell]) & ~grown;
+    }
+    memcpy(tile, ",,,,,\n,,,,,\n,,,,,\n,,,,,\n,,,,,\n", 30);
+    while (grown != 0) {
+        int cell = __builtin_ctz(grown);
+        tile[cell / 5 * 6 + cell % 5] = '!';
+        grown &= grown - 1;
+    }
+}
+
+/* Writes "rows" random board rows of "cols" cells, each cell covered with
+probability "density" by either player's marker. */
+void generate_board_rows(Random* random, long rows, long cols,
+        double density, OutputBuffer* output) {
+    // each cell takes 16 random bits: it is covered when the top 15 fall
+    // below the threshold, and the last one picks the player
+    unsigned threshold = (unsigned)(density * 32768 + 0.5);
+    char* cellFor = malloc(1 << 16);
+    for (unsigned bits = 0; bits < (1 << 16); bits++) {
+        cellFor[bits] = (bits >> 1) >= threshold ? '.' :
+                ((bits & 1) ? '#' : '*');
+    }
+    for (long r = 0; r < rows; r++) {
+        output_reserve(output, cols + 1);
+        char* row = output->data + output->length;
+        long c = 0;
+        for (; c + 4 <= cols; c += 4) {
+            uint64_t bits = next_random(random);
+            row[c] = cellFor[bits & 0xffff];
+            row[c + 1] = cellFor[(bits >> 16) & 0xffff];
+            row[c + 2] = cellFor[(bits >> 32) & 0xffff];
+            row[c + 3] = cellFor[bits >> 48];
+        }
+        for (; c < cols; c++) {
+            row[c] = cellFor[random_bits(random, 16)];
+        }
+        row[cols] = '\n';
+        output->length += cols + 1;
+    }
+    free(cellFor);
+}
+
+/* Parses a whole-number argument between "min" and "max" into "*value".
+Returns 0 if it isn't one. */
+Bool parse_count(char* arg, long min, long max, long* value) {
+    char* end;
+    *value = strtol(arg, &end, 10);
+    return *end == '\0' && end != arg && *value >= min && *value <= max;
+}
+
+/* Parses a density between 0 and 1 into "*density". Returns 0 if the
+argument isn't one. */
+static Bool parse_density(char* arg, double* density) {
+    char* end;
+    *density = strtod(arg, &end);
+    return *end == '\0' && end != arg && *density >= 0 && *density <= 1;
+}
+
+/* Writes "count" random tiles of up to "maxCells" cells as a tile file. */
+static void generate_tiles(Random* random, long count, int maxCells,
+        OutputBuffer* output) {
+    for (long i = 0; i < count; i++) {
+        output_reserve(output, 31);
+        generate_tile(random, maxCells, output->data + output->length);
+        output->length += 30;
+        if (i != count - 1) {
+            output->data[output->length++] = '\n';
+        }
+    }
+}
+
+/* Prints the generator's usage message. */
+static void generator_usage(void) {
+    fprintf(stderr, "Usage: fitz --generate tiles seed count [maxcells]\n");
+    fprintf(stderr, "       fitz --generate board seed height width ");
+    fprintf(stderr, "density\n");
+    fprintf(stderr, "       fitz --generate save seed tilecount height ");
+    fprintf(stderr, "width density\n");
+}
+
+/* Runs "fitz --generate kind seed ...", writing a tile file, a board or a
+save file to standard output. The same arguments always produce the same
+output. Returns the program's exit status. */
+int run_generator(char** args, int argCount) {
+    long seed, count, maxCells = GENERATE_DEFAULT_CELLS, tilesCount, rows, cols;
+    double density;
+    if (argCount < 2 || !parse_count(args[1], 0, 0x7fffffffL, &seed)) {
+        generator_usage();
+        return 1;
+    }
+    Random random = {(uint64_t)seed, 0, 0};
+    OutputBuffer output = {malloc(GENERATE_BUFFER_SIZE), 0, stdout, 0};
+    Bool valid = 1;
+    if (strcmp(args[0], "tiles") == 0 && (argCount == 3 || argCount == 4)) {
+        valid = parse_count(args[2], 1, 0x7fffffffL, &count) &&
+                (argCount == 3 || parse_count(args[3], 1, 25, &maxCells));
+        if (valid) {
+            generate_tiles(&random, count, maxCells, &output);
+        }
+    } else if (strcmp(args[0], "board") == 0 && argCount == 5) {
+        valid = parse_count(args[2], 1, GENERATE_MAX_DIMENSION, &rows) &&
+                parse_count(args[3], 1, GENERATE_MAX_DIMENSION, &cols) &&
+                parse_density(args[4], &density);
+        if (valid) {
+            generate_board_rows(&random, rows, cols, density, &output);
+        }
+    } else if (strcmp(args[0], "save") == 0 && argCount == 6) {
+        valid = parse_count(args[2], 1, 0x7fffffffL, &tilesCount) &&
+                parse_count(args[3], 1, GENERATE_MAX_DIMENSION, &rows) &&
+                parse_count(args[4], 1, GENERATE_MAX_DIMENSION, &cols) &&
+                parse_density(args[5], &density);
+        if (valid) {
+            output.length = sprintf(output.data, "%ld %d %ld %ld\n",
+                    (long)random_below(&random, tilesCount),
+                    (int)random_below(&random, 2), rows, cols);
+            generate_board_rows(&random, rows, cols, density, &output);
+        }
+    } else {
+        valid = 0;
+    }
+    if (!valid) {
+        free(output.data);
+        generator_usage();
+        return 1;
+    }
+    output_reserve(&output, GENERATE_BUFFER_SIZE);
+    free(output.data);
+    if (output.failed || fflush(stdout) != 0) {
+        fprintf(stderr, "Unable to write output\n");
+        return 21;
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef GENERATE_H
+#define GENERATE_H
+
+#include <stdint.h>
+#include "head.h"
+
+// largest board height or width the generator writes; bigger than the game
+// allows, so that the loaders can be stress-tested
+#define GENERATE_MAX_DIMENSION 100000
+// default largest number of cells of a generated tile
+#define GENERATE_DEFAULT_CELLS 8
+// size of the buffer output is assembled in before it is written
+#define GENERATE_BUFFER_SIZE (1 << 20)
+
+// state of the generator's pseudo-random number sequence
+typedef struct {
+    uint64_t state;
+    uint64_t bits;      // unused random bits, taken from the low end
+    int bitsLeft;
+} Random;
+
+// output assembled in a large buffer and written in big blocks
+typedef struct {
+    char* data;
+    size_t length;
+    FILE* out;
+    Bool failed;
+} OutputBuffer;
+
+//function prototypes
+int run_generator(char** args, int argCount);
+uint64_t next_random(Random* random);
+uint64_t random_below(Random* random, uint64_t bound);
+unsigned random_bits(Random* random, int count);
+void generate_tile(Random* random, int maxCells, char* tile);
+void generate_board_rows(Random* random, long rows, long cols,
+        double density, OutputBuffer* output);
+void output_reserve(OutputBuffer* output, size_t length);
+Bool parse_count(char* arg, long min, long max, long* value);
+
+#endif
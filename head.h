@@ -1,75 +1,97 @@
+#ifndef HEAD_H
+#define HEAD_H
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include "fitz.h"
+
+typedef int Bool;
 
+// search time of automated player 3 when moves aren't timed
+#define DEFAULT_SEARCH_MS 100
+// time allowed for answering a human player's "hint"
+#define DEFAULT_HINT_MS 50
+
+// an external engine player (see engine.h)
+typedef struct Engine Engine;
+// a reader of human input with deadlines (see timing.h)
+typedef struct TimedInput TimedInput;
+
+// a window onto part of the board, shown instead of the whole board
 typedef struct {
-    char* grid;
-    int nextTile;
-    int nextPlayer;
-    int rows;
-    int cols;
-} Game;
+    int height;         // rows shown, or 0 to show the whole board
+    int width;          // columns shown
+    Bool following;     // centred on the last move
+    int centreRow;      // the centre if not following
+    int centreCol;
+} Viewport;
 
-typedef int Bool;
+// how a game is reported on standard output (see events.c)
+typedef enum {
+    OUTPUT_TEXT,        // boards, tiles and prompts for people
+    OUTPUT_JSONL,       // one JSON event per line
+    OUTPUT_BINARY       // fixed-size binary events
+} OutputMode;
+
+// human players' moves read from a "--moves" file (see script.c)
+typedef struct {
+    FitzMove* moves;
+    long* lines;        // the line of the file each move is on
+    long count;
+    long next;          // index of the next move to play
+} MoveScript;
+
+// the options given on the command line before the tile file: time controls,
+// the book and cache, the move script, display, output and autosaving
+typedef struct {
+    int moveMs;         // limit on each move, or -1 if moves aren't timed
+    int hintMs;         // time allowed for a hint
+    TimedInput* input;  // standard input, if moves are timed
+    char* bookPath;     // opening book for player 3 and hints, or NULL
+    char* cachePath;    // position cache shared with other runs, or NULL
+    char* movesPath;    // move script for human players, or NULL
+    MoveScript* script; // the move script once loaded
+    Viewport view;      // how much of the board is shown
+    OutputMode output;
+    Bool pipeline;      // moves are shown by an output thread (see render.c)
+    char* autosavePath; // file the game is saved to as it goes, or NULL
+    int autosaveMoves;  // moves between autosaves
+    int autosaveMs;     // longest time between autosaves
+} Options;
 
 //function prototypes
+int parse_leading_options(int argc, char** argv, Options* options);
+void load_script(Options* options);
 void check_arg_count(int argc);
-FILE* open_tile_file(char* filename);
-char** process_get_tiles(FILE* tileFile);
-void check_player_types(char* playerType1, char* playerType2, char** tiles,
-        int tilesCount);
-void process_shape_display(int argc, char** tiles, int tilesCount,
-        FILE* tileFile);
-void process_new_game(int argc, char** argv, Game* currentGame, char** tiles,
-        int tilesCount, FILE* tileFile, char* playerType1, char* playerType2);
-void process_saved_game(int argc, char** argv, Game* currentGame, char** tiles,
-        int tilesCount, FILE* tileFile, char* playerType1, char* playerType2);
-void print_winner(int nextPlayer);
-void play_game(Game* currentGame, char** tiles, int tilesCount,
-        char* playerType1, char* playerType2, int** recentPlays,
-        FILE* tileFile);
-Bool game_over(Game currentGame, char** tiles);
-char* read_file(FILE* input, int tilesCount);
-char* new_grid(int rows, int cols);
-int* read_parameters(FILE* input);
-int check_saved_game(int* parameters, char* grid, int gridLength, int
-	tilesCount);
-void print_grid(Game currentGame);
-char* rotate_tile_90(char* grid);
-int coordinate_to_index(int rows, int cols, int y, int x);
-char* rotate_tile(char* grid, int angle);
-char** get_tiles(FILE* tileFile);
-int get_tiles_count(FILE* tileFile);
-void shape_display(char** tiles, int tilesCount);
-void free_tiles_mem(char** tiles, int tilesCount);
-Bool check_tile_file(FILE* tileFile);
-char* place_tile(char* board, int boardLength, int boardHeight, char* tile, int
-        player, int y, int x, int angle);
+void exit_with_error(FitzError error);
+FitzTiles* load_tiles(char* filename);
+void check_player_types(char* playerType1, char* playerType2,
+        FitzTiles* tiles);
+void process_shape_display(int argc, FitzTiles* tiles);
+FitzGame* process_new_game(int argc, char** argv, FitzTiles* tiles);
+FitzGame* process_saved_game(int argc, char** argv, FitzTiles* tiles);
+void start_engines(Engine** engines, FitzGame* currentGame,
+        FitzTiles* tiles, char* playerType1, char* playerType2);
+void stop_engines(Engine** engines);
+int play_game(FitzGame* currentGame, char* playerType1, char* playerType2,
+        Engine** engines, Options* options);
+void print_winner(int nextPlayer, FILE* out);
+void display_board(FitzGame* currentGame, Options* options, FILE* out);
+void display_next_tile(char* pType1, char* pType2, FitzGame* currentGame,
+        FILE* out);
 char* read_line(FILE* file);
-int count_tile_markers(char* tile);
 Bool valid_player_types(char* pType1, char* pType2);
-char* get_marker(int player);
-int move(Game* currentGamePtr, char* pType1, char* pType2, char** tiles, int**
-        recentPlays);
-int human_move(Game* currentGamePtr, char** tiles, int** recentPlays,
-        char* input);
-int* get_human_input(char* input);
-void prompt_player(int player);
-void free_input_mem(char** resultStrs);
-int automated_move_1(Game* currentGamePtr, char** tiles, int** recentPlays);
-void automated_display(int player, int r, int c, int theta);
-int automated_move_2(Game* currentGamePtr, char** tiles, int** recentPlays);
-int index_to_x_coordinate(int rows, int cols, int index);
-int index_to_y_coordinate(int rows, int cols, int index);
-char* rotate_tile_270(char* grid);
-Bool valid_tile_placement(char* board, int boardLength, int boardHeight,
-        char* tile, int player, int y, int x, int angle);
+FitzPlayerKind player_kind(char* pType);
+int supply_move(FitzGame* currentGame, Engine* engine,
+        Options* options, double deadline, FitzMove* chosen);
+int read_human_input(Options* options, double deadline, char** input);
+void display_hint(FitzGame* currentGame, int budgetMs, FILE* out);
+void report_hint(FitzGame* currentGame, Options* options);
 char* check_save_command(char* input);
-int save_game(Game currentGame, char* outputPath);
-void free_mem_recent_plays(int** recentPlays);
-void display_next_tile(char* pType1, char* pType2, int nextPlayer,
-        int nextTile, char** tiles);
-void a1_assign_initial_values(int** recentPlays, int* r, int* c);
-void a2_assign_initial_values(Game* currentGame, int** recentPlays, int* r,
-        int* c);
+int human_move(FitzGame* currentGame, char* input, FitzMove* chosen);
+void prompt_player(int player, FILE* out);
+void automated_display(int player, int r, int c, int theta, FILE* out);
+
+#endif
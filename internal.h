@@ -0,0 +1,163 @@
+#ifndef INTERNAL_H
+#define INTERNAL_H
+
+#include <stdio.h>
+#include "fitz.h"
+
+/* Declarations shared by the libfitz sources. Nothing here is part of the
+public interface in fitz.h. */
+
+// width of the padding around the free rows: a marker is at most half the
+// tile size from an anchor, which is itself at most that far off the board
+#define FREE_BORDER FITZ_MAX_TILE_SIZE
+
+// the occupancy pyramid's level whose blocks are as wide as a word of anchors,
+// and the rows they span
+#define PYRAMID_WORD_LEVEL 6
+#define PYRAMID_BAND (1 << PYRAMID_WORD_LEVEL)
+
+// counts of empty cells in blocks of 2^k x 2^k anchors (see occupancy.c)
+typedef struct {
+    int levelCount;
+    int* heights;       // blocks per column at each level
+    int* widths;        // blocks per row at each level
+    int** counts;       // counts[level][i * widths[level] + j], for level >= 1
+} OccupancyPyramid;
+
+typedef struct {
+    char* grid;
+    int nextTile;
+    int nextPlayer;
+    int rows;
+    int cols;
+    int margin;         // how far anchors reach off the board (see FitzTiles)
+    // row-wise prefix sums of empty cells: emptyCounts[r * (cols + 1) + c]
+    // is the number of empty cells in row r left of column c
+    int* emptyCounts;
+    // the empty cells as padded bit rows of freeWords words each (see
+    // occupancy.c)
+    int freeWords;
+    uint64_t* freeRows;
+    OccupancyPyramid* pyramid;
+    uint64_t boardHash;     // hash of the markers on the board (see cache.c)
+} Game;
+
+typedef int Bool;
+
+// search time of automated player 3 in fitz_game_step() until one is set
+#define STEP_SEARCH_MS 100
+
+// questions about a position answered by position caches; a query is one of
+// these in its low 8 bits and the question's parameters above them
+typedef enum {
+    QUERY_GAME_OVER,    // the answer is 1 or 0
+    QUERY_AUTO_MOVE,    // automated player, row and column the scan starts at
+    QUERY_SEARCH        // search time of automated player 3
+} CacheQuery;
+
+// a rotated tile as the offsets of its markers from the tile's centre
+typedef struct {
+    int count;
+    signed char dy[FITZ_MAX_TILE_SIZE * FITZ_MAX_TILE_SIZE];
+    signed char dx[FITZ_MAX_TILE_SIZE * FITZ_MAX_TILE_SIZE];
+    // the markers over their bounding box: bit 8 * i + j for offset
+    // (minDy + i, minDx + j)
+    uint64_t mask;
+    // bounding box of the markers (only meaningful if count > 0)
+    int minDy;
+    int maxDy;
+    int minDx;
+    int maxDx;
+} TileShape;
+
+struct FitzTiles {
+    char** tiles;       // as in the tile file: "size" lines of "size" cells
+    int tilesCount;
+    int size;           // height and width of every tile
+    int margin;         // size / 2: how far anchors reach off the board
+    TileShape* shapes;  // tile i rotated by angle is at [i * 4 + angle / 90]
+    uint64_t hash;      // fitz_tiles_hash(), worked out once when loaded
+};
+
+struct FitzGame {
+    Game state;
+    const FitzTiles* library;
+    int** recentPlays;
+    FitzEval* eval;     // kept in step with the game once a search is made
+    const FitzBook* book;   // consulted before searching, if not NULL
+    FitzPlayerKind players[2];  // who moves for each player in steps
+    int searchMs;       // search time of FITZ_PLAYER_SEARCH players
+    int over;           // the game is over: 1 or 0, or -1 if not checked yet
+    FitzCache* cache;   // answers positions before they're worked out, or NULL
+    uint64_t keyBase;   // hash of the tiles and dimensions, for position keys
+};
+
+//function prototypes - tiles.c
+Bool read_tiles(FILE* tileFile, FitzTiles* library);
+uint64_t tile_mask(const char* tile, int size);
+uint64_t rotate_mask(uint64_t mask, int size, int angle);
+void shape_display(const FitzTiles* library, FILE* out);
+void free_tiles_mem(char** tiles, int tilesCount);
+void build_tile_shape(const char* tile, int size, int angle,
+        TileShape* shape);
+
+//function prototypes - board.c
+char* new_grid(int rows, int cols);
+char* read_file(FILE* input, int tilesCount);
+int* read_parameters(FILE* input);
+int check_saved_game(int* parameters, char* grid, int gridLength, int
+	tilesCount);
+void print_grid(Game currentGame, FILE* out);
+Bool tile_fits(const Game* currentGame, const TileShape* shape, int y,
+        int x);
+void put_tile(Game* currentGame, const TileShape* shape, int player, int y,
+        int x);
+Bool game_over(Game currentGame, const FitzTiles* library);
+int* new_empty_counts(char* grid, int rows, int cols);
+void update_empty_counts(Game* currentGame, int y);
+long count_empty_cells(const Game* currentGame, int top, int bottom,
+        int left, int right);
+int save_game(Game currentGame, const char* outputPath);
+
+//function prototypes - occupancy.c
+void new_free_rows(Game* currentGame);
+void update_occupancy(Game* currentGame, int y, int x);
+OccupancyPyramid* new_pyramid(Game* currentGame);
+void free_pyramid(OccupancyPyramid* pyramid);
+void update_pyramid(Game* currentGame, int y, int x);
+Bool candidate_words(const Game* currentGame, int markers, int r,
+        Bool* candidates);
+
+//function prototypes - legal.c
+Bool legal_anchor_row(const Game* currentGame, const TileShape* shape, int r,
+        const Bool* candidates, uint64_t* bits);
+Bool first_legal_anchor(const Game* currentGame, const TileShape* shapes,
+        int angles, int rStart, int cStart, int direction, int* r, int* c);
+
+//function prototypes - book.c
+uint64_t hash_tiles(const FitzTiles* tiles);
+
+//function prototypes - cache.c
+uint64_t mix_bits(uint64_t x);
+uint64_t cell_key(long cell, int player);
+uint64_t board_hash(const Game* currentGame);
+uint64_t position_query_key(const FitzGame* game, uint64_t query);
+Bool cache_lookup(const FitzCache* cache, uint64_t key, uint64_t* value);
+void cache_store(FitzCache* cache, uint64_t key, uint64_t value);
+
+//function prototypes - players.c
+int** new_recent_plays(void);
+void free_mem_recent_plays(int** recentPlays);
+void record_play(int** recentPlays, int player, int r, int c);
+int* get_human_input(const char* input);
+void free_input_mem(char** resultStrs);
+void a1_assign_initial_values(Game* currentGame, int** recentPlays, int* r,
+        int* c);
+int automated_move_1(Game* currentGamePtr, const FitzTiles* library,
+        int** recentPlays, FitzMove* chosen);
+void a2_assign_initial_values(Game* currentGame, int** recentPlays, int* r,
+        int* c);
+int automated_move_2(Game* currentGamePtr, const FitzTiles* library,
+        int** recentPlays, FitzMove* chosen);
+
+#endif
@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "internal.h"
+
+/* The legal anchors of a rotated tile are the correlation of the free cells
+with the tile's markers: anchor (r, c) is legal when the cell under every
+marker is free. With the free cells held as bit rows (see occupancy.c), a
+whole row of anchors is worked out 64 at a time, as the AND over the markers
+of the free row under each marker shifted by its column offset. Rows whose
+band of cells can't hold the tile are ruled out from the empty cell counts
+without reading the free rows, and scans first ask the occupancy pyramid
+which words of a row are worth computing at all. */
+
+/* Returns the number of words in a row of anchors of a game's board. */
+static int anchor_words(const Game* currentGame) {
+    return (currentGame->cols + 2 * currentGame->margin + 63) / 64;
+}
+
+/* Computes the legal anchors of "shape" in anchor row "r" for the player to
+move: anchor (r, c) is bit (c + margin) % 64 of word (c + margin) / 64 of
+"bits", which must hold a row of anchor words. If "candidates" isn't NULL,
+only the words it marks (see candidate_words()) are computed and the others
+are left empty. Returns 1 if any anchor of the row is legal, otherwise 0. */
+Bool legal_anchor_row(const Game* currentGame, const TileShape* shape, int r,
+        const Bool* candidates, uint64_t* bits) {
+    int words = anchor_words(currentGame);
+    int width = currentGame->cols + 2 * currentGame->margin;
+    if (shape->count > 0 && count_empty_cells(currentGame, r + shape->minDy,
+            r + shape->maxDy, 0, currentGame->cols - 1) < shape->count) {
+        memset(bits, 0, sizeof(uint64_t) * words);
+        return 0;
+    }
+    for (int w = 0; w < words; w++) {
+        bits[w] = candidates == NULL || candidates[w] ? ~(uint64_t)0 : 0;
+    }
+    if (width % 64 != 0) {
+        bits[words - 1] &= ((uint64_t)1 << (width % 64)) - 1;
+    }
+    for (int m = 0; m < shape->count; m++) {
+        // the marker of anchor bit x covers padded column
+        // x + dx + FREE_BORDER - margin
+        const uint64_t* freeRow = currentGame->freeRows +
+                (long)(r + shape->dy[m] + FREE_BORDER) *
+                currentGame->freeWords;
+        int shift = shape->dx[m] + FREE_BORDER - currentGame->margin;
+        for (int w = 0; w < words; w++) {
+            if (bits[w] == 0) {
+                continue;
+            }
+            uint64_t cells = freeRow[w] >> shift;
+            if (shift > 0) {
+                cells |= freeRow[w + 1] << (64 - shift);
+            }
+            bits[w] &= cells;
+        }
+    }
+    uint64_t any = 0;
+    for (int w = 0; w < words; w++) {
+        any |= bits[w];
+    }
+    return any != 0;
+}
+
+/* Returns the lowest ("direction" 1) or highest (-1) set bit of "bits" in
+[low, high), or -1 if there is none. */
+static int find_bit(const uint64_t* bits, int low, int high, int direction) {
+    if (low >= high) {
+        return -1;
+    }
+    int first = direction > 0 ? low / 64 : (high - 1) / 64;
+    int last = direction > 0 ? (high - 1) / 64 : low / 64;
+    for (int w = first; w != last + direction; w += direction) {
+        uint64_t word = bits[w];
+        if (w == low / 64) {
+            word &= ~(uint64_t)0 << (low % 64);
+        }
+        if (w == (high - 1) / 64 && high % 64 != 0) {
+            word &= ((uint64_t)1 << (high % 64)) - 1;
+        }
+        if (word != 0) {
+            return w * 64 + (direction > 0 ? __builtin_ctzll(word) :
+                    63 - __builtin_clzll(word));
+        }
+    }
+    return -1;
+}
+
+/* Finds the first anchor a scan of the anchor domain reaches where "shapes"
+(a tile's four rotations) fit in at least one of "angles" (a set of
+FITZ_ANGLE_BIT values). The scan starts at (rStart, cStart) and goes along
+each row and then on to the next one, forwards ("direction" 1) or backwards
+(-1), wrapping around the domain and ending just before its start. The anchor
+found is stored in "r" and "c". Returns 0 if there is none, otherwise 1. */
+Bool first_legal_anchor(const Game* currentGame, const TileShape* shapes,
+        int angles, int rStart, int cStart, int direction, int* r, int* c) {
+    int margin = currentGame->margin;
+    int height = currentGame->rows + 2 * margin;
+    int width = currentGame->cols + 2 * margin;
+    int words = anchor_words(currentGame);
+    uint64_t* row = malloc(sizeof(uint64_t) * words);
+    uint64_t* anyAngle = malloc(sizeof(uint64_t) * words);
+    Bool* candidates = malloc(sizeof(Bool) * words);
+    int candidateBand = -1;
+    Bool worthComputing = 0;
+    int y = rStart + margin;
+    int x = -1;
+    // the start row is visited twice: from the start on and then, after
+    // wrapping around, up to it
+    for (int i = 0; i <= height && x == -1; i++) {
+        memset(anyAngle, 0, sizeof(uint64_t) * words);
+        Bool found = 0;
+        // every rotation of a tile has the same markers, and the words the
+        // pyramid picks only change from one band of PYRAMID_BAND rows to
+        // the next, so one look serves the whole band
+        if (y / PYRAMID_BAND != candidateBand) {
+            candidateBand = y / PYRAMID_BAND;
+            worthComputing = candidate_words(currentGame, shapes[0].count,
+                    y - margin, candidates);
+        }
+        for (int a = 0; a < 4 && worthComputing; a++) {
+            if ((angles & (1 << a)) &&
+                    legal_anchor_row(currentGame, &shapes[a], y - margin,
+                    candidates, row)) {
+                for (int w = 0; w < words; w++) {
+                    anyAngle[w] |= row[w];
+                }
+                found = 1;
+            }
+        }
+        if (found) {
+            int low = 0;
+            int high = width;
+            if (i == 0) {
+                low = direction > 0 ? cStart + margin : 0;
+                high = direction > 0 ? width : cStart + margin + 1;
+            } else if (i == height) {
+                low = direction > 0 ? 0 : cStart + margin + 1;
+                high = direction > 0 ? cStart + margin : width;
+            }
+            x = find_bit(anyAngle, low, high, direction);
+        }
+        if (x == -1) {
+            y = (y + direction + height) % height;
+        }
+    }
+    free(row);
+    free(anyAngle);
+    free(candidates);
+    if (x == -1) {
+        return 0;
+    }
+    *r = y - margin;
+    *c = x - margin;
+    return 1;
+}
+
+/* Computes the legal anchors of each requested tile in each requested
+rotation ("angles" is a set of FITZ_ANGLE_BIT values) for the player to move,
+in one pass over the board. The bitmaps are stored in "map" tile by tile, in
+the order of "tileIndexes", and for each tile by increasing angle. Anchor (r, c)
+is legal exactly when tile_fits() would accept it. */
+FitzError fitz_game_legal_map(const FitzGame* game, const int* tileIndexes,
+        int tileCount, int angles, FitzLegalMap* map) {
+    const FitzTiles* library = game->library;
+    if (tileCount < 1 || angles < 1 || angles > FITZ_ALL_ANGLES) {
+        return FITZ_ERR_ARGUMENT;
+    }
+    for (int i = 0; i < tileCount; i++) {
+        if (tileIndexes[i] < 0 || tileIndexes[i] >= library->tilesCount) {
+            return FITZ_ERR_ARGUMENT;
+        }
+    }
+    int shapeCount = 0;
+    const TileShape** shapes = malloc(sizeof(TileShape*) * 4 * tileCount);
+    for (int i = 0; i < tileCount; i++) {
+        for (int a = 0; a < 4; a++) {
+            if (angles & (1 << a)) {
+                shapes[shapeCount++] =
+                        &library->shapes[tileIndexes[i] * 4 + a];
+            }
+        }
+    }
+
+    map->margin = game->state.margin;
+    map->height = game->state.rows + 2 * map->margin;
+    map->width = game->state.cols + 2 * map->margin;
+    map->wordsPerRow = anchor_words(&game->state);
+    map->count = shapeCount;
+    long mapWords = (long)map->wordsPerRow * map->height;
+    map->bits = malloc(sizeof(uint64_t) * mapWords * shapeCount);
+    // map row y is anchor row y - margin
+    for (int y = 0; y < map->height; y++) {
+        for (int s = 0; s < shapeCount; s++) {
+            legal_anchor_row(&game->state, shapes[s], y - map->margin, NULL,
+                    map->bits + s * mapWords + (long)y * map->wordsPerRow);
+        }
+    }
+    free(shapes);
+    return FITZ_OK;
+}
+
+/* Checks whether anchor (row, col) is legal in bitmap "index" of a legal map.
+Returns 1 if yes, otherwise 0 (also for an anchor outside the map). */
+int fitz_legal_map_test(const FitzLegalMap* map, int index, int row,
+        int col) {
+    int y = row + map->margin;
+    int x = col + map->margin;
+    if (index < 0 || index >= map->count || y < 0 || y >= map->height ||
+            x < 0 || x >= map->width) {
+        return 0;
+    }
+    long word = ((long)index * map->height + y) * map->wordsPerRow + x / 64;
+    return (map->bits[word] >> (x % 64)) & 1;
+}
+
+/* Returns the number of legal anchors in bitmap "index" of a legal map. */
+long fitz_legal_map_count(const FitzLegalMap* map, int index) {
+    long mapWords = (long)map->wordsPerRow * map->height;
+    const uint64_t* bits = map->bits + index * mapWords;
+    long count = 0;
+    for (long i = 0; i < mapWords; i++) {
+        count += __builtin_popcountll(bits[i]);
+    }
+    return count;
+}
+
+/* Frees the bitmaps of a legal map. */
+void fitz_legal_map_free(FitzLegalMap* map) {
+    free(map->bits);
+    map->bits = NULL;
+    map->count = 0;
+}
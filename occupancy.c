@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "internal.h"
+
+/* The free rows hold the board's empty cells as bits, for the legal-anchor
+kernel in legal.c and tile_fits(). The board is padded by FREE_BORDER cells on
+every side, so that every cell a marker of a tile anchored in the anchor domain
+[-margin, rows + margin) x [-margin, cols + margin) can cover has a bit: cell
+(r, c) is bit (c + FREE_BORDER) % 64 of word (c + FREE_BORDER) / 64 of padded
+row r + FREE_BORDER. Cells off the board are never free. Each row ends with a
+spare word so that a tile row or a word of anchors can always be read with the
+word after it. */
+
+/* Sets or clears the bit of board cell (r, c) from the grid. */
+static void refresh_free_cell(Game* currentGame, int r, int c) {
+    uint64_t* row = currentGame->freeRows +
+            (long)(r + FREE_BORDER) * currentGame->freeWords;
+    int bit = c + FREE_BORDER;
+    uint64_t mask = (uint64_t)1 << (bit % 64);
+    if (currentGame->grid[r * (currentGame->cols + 1) + c] == '.') {
+        row[bit / 64] |= mask;
+    } else {
+        row[bit / 64] &= ~mask;
+    }
+}
+
+/* Builds the free rows of a game's board. */
+void new_free_rows(Game* currentGame) {
+    int rows = currentGame->rows;
+    int cols = currentGame->cols;
+    currentGame->freeWords = (cols + 2 * FREE_BORDER + 63) / 64 + 1;
+    currentGame->freeRows = calloc((long)(rows + 2 * FREE_BORDER) *
+            currentGame->freeWords, sizeof(uint64_t));
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            refresh_free_cell(currentGame, r, c);
+        }
+    }
+}
+
+/* Brings the empty cell counts and the free rows up to date after a tile
+anchored at (y, x) has been placed on the board. */
+void update_occupancy(Game* currentGame, int y, int x) {
+    update_empty_counts(currentGame, y);
+    int margin = currentGame->margin;
+    for (int r = y - margin; r <= y + margin; r++) {
+        for (int c = x - margin; c <= x + margin; c++) {
+            if (r >= 0 && r < currentGame->rows && c >= 0 &&
+                    c < currentGame->cols) {
+                refresh_free_cell(currentGame, r, c);
+            }
+        }
+    }
+}
+
+/* The occupancy pyramid counts the empty cells of the anchor domain in
+square blocks. Positions are shifted by the margin, so that anchor (r, c) is
+position (r + margin, c + margin); positions off the board count as full.
+Level k holds one count per aligned 2^k x 2^k block, so a count of 0 marks a
+full block, a count of 4^k an empty one and anything else a mixed one. A
+shifted column is also the anchor's bit in a row of anchor words, so a block
+of level PYRAMID_WORD_LEVEL covers exactly one word, and the words
+candidate_words() picks for a row only depend on its band of PYRAMID_BAND
+rows. */
+
+/* Returns 1 if the cell at shifted position (i, j) is on the board and empty,
+otherwise 0. */
+static int shifted_cell_empty(const Game* currentGame, int i, int j) {
+    int row = i - currentGame->margin;
+    int col = j - currentGame->margin;
+    if (row < 0 || row >= currentGame->rows || col < 0 ||
+            col >= currentGame->cols) {
+        return 0;
+    }
+    return currentGame->grid[row * (currentGame->cols + 1) + col] == '.';
+}
+
+/* Returns the empty cell count of block (i, j) of level "level", where level
+0 is the shifted board itself. Blocks off the level count as full. */
+static int block_count(const Game* currentGame, int level, int i, int j) {
+    const OccupancyPyramid* pyramid = currentGame->pyramid;
+    if (level == 0) {
+        return shifted_cell_empty(currentGame, i, j);
+    }
+    if (i < 0 || j < 0 || i >= pyramid->heights[level] ||
+            j >= pyramid->widths[level]) {
+        return 0;
+    }
+    return pyramid->counts[level][i * pyramid->widths[level] + j];
+}
+
+/* Recomputes block (i, j) of "level" (at least 1) from its four children. */
+static void refresh_block(Game* currentGame, int level, int i, int j) {
+    OccupancyPyramid* pyramid = currentGame->pyramid;
+    pyramid->counts[level][i * pyramid->widths[level] + j] =
+            block_count(currentGame, level - 1, 2 * i, 2 * j) +
+            block_count(currentGame, level - 1, 2 * i, 2 * j + 1) +
+            block_count(currentGame, level - 1, 2 * i + 1, 2 * j) +
+            block_count(currentGame, level - 1, 2 * i + 1, 2 * j + 1);
+}
+
+/* Builds the occupancy pyramid of a game's board, up to the level whose
+single block covers the whole anchor domain. */
+OccupancyPyramid* new_pyramid(Game* currentGame) {
+    OccupancyPyramid* pyramid = malloc(sizeof(OccupancyPyramid));
+    int height = currentGame->rows + 2 * currentGame->margin;
+    int width = currentGame->cols + 2 * currentGame->margin;
+    int levels = 1;
+    while ((1 << (levels - 1)) < height || (1 << (levels - 1)) < width) {
+        levels++;
+    }
+    pyramid->levelCount = levels;
+    pyramid->heights = malloc(sizeof(int) * levels);
+    pyramid->widths = malloc(sizeof(int) * levels);
+    pyramid->counts = malloc(sizeof(int*) * levels);
+    pyramid->heights[0] = height;
+    pyramid->widths[0] = width;
+    pyramid->counts[0] = NULL;
+    currentGame->pyramid = pyramid;
+    for (int level = 1; level < levels; level++) {
+        int size = 1 << level;
+        pyramid->heights[level] = (height + size - 1) / size;
+        pyramid->widths[level] = (width + size - 1) / size;
+        pyramid->counts[level] = malloc(sizeof(int) *
+                pyramid->heights[level] * pyramid->widths[level]);
+        for (int i = 0; i < pyramid->heights[level]; i++) {
+            for (int j = 0; j < pyramid->widths[level]; j++) {
+                refresh_block(currentGame, level, i, j);
+            }
+        }
+    }
+    return pyramid;
+}
+
+/* Frees an occupancy pyramid. */
+void free_pyramid(OccupancyPyramid* pyramid) {
+    for (int level = 1; level < pyramid->levelCount; level++) {
+        free(pyramid->counts[level]);
+    }
+    free(pyramid->counts);
+    free(pyramid->heights);
+    free(pyramid->widths);
+    free(pyramid);
+}
+
+/* Brings the occupancy pyramid up to date after a tile anchored at (y, x)
+has been placed on the board. */
+void update_pyramid(Game* currentGame, int y, int x) {
+    OccupancyPyramid* pyramid = currentGame->pyramid;
+    // the changed cells are within the margin of the anchor, which puts them
+    // at shifted rows y to y + 2 * margin and likewise for columns
+    int reach = 2 * currentGame->margin;
+    int top = y < 0 ? 0 : y;
+    int bottom = y + reach;
+    int left = x < 0 ? 0 : x;
+    int right = x + reach;
+    for (int level = 1; level < pyramid->levelCount; level++) {
+        top >>= 1;
+        bottom >>= 1;
+        left >>= 1;
+        right >>= 1;
+        for (int i = top; i <= bottom && i < pyramid->heights[level]; i++) {
+            for (int j = left; j <= right && j < pyramid->widths[level];
+                    j++) {
+                refresh_block(currentGame, level, i, j);
+            }
+        }
+    }
+}
+
+/* Checks whether no anchor in block (i, j) of "level" can hold a tile of
+"markers" markers: the cells its tiles could cover lie in that block and its
+eight neighbours, as blocks are at least as wide as the margin, and those
+have fewer empty cells than that. Returns 1 if so. */
+static Bool anchor_block_full(const Game* currentGame, int level, int i,
+        int j, int markers) {
+    int empty = 0;
+    for (int di = -1; di <= 1; di++) {
+        for (int dj = -1; dj <= 1; dj++) {
+            empty += block_count(currentGame, level, i + di, j + dj);
+        }
+    }
+    return empty < markers;
+}
+
+/* Descends from block (i >> level, j) of "level" towards the blocks of
+shifted row "i" that might hold a tile of "markers" markers, skipping every
+block whose neighbourhood is too full, and marks the anchor words it reaches
+in "candidates". */
+static void mark_words(const Game* currentGame, int markers, int level,
+        int i, int j, Bool* candidates) {
+    if (anchor_block_full(currentGame, level, i >> level, j, markers)) {
+        return;
+    }
+    if (level <= PYRAMID_WORD_LEVEL) {
+        candidates[(j << level) / 64] = 1;
+        return;
+    }
+    for (int child = 2 * j; child <= 2 * j + 1 &&
+            child < currentGame->pyramid->widths[level - 1]; child++) {
+        mark_words(currentGame, markers, level - 1, i, child, candidates);
+    }
+}
+
+/* Finds the words of anchor row "r" where a tile of "markers" markers might
+fit, as a coarse filter in front of legal_anchor_row(): "candidates" gets one
+flag per anchor word, and a word left unmarked certainly has no legal anchor.
+Returns 1 if any word is marked, otherwise 0. */
+Bool candidate_words(const Game* currentGame, int markers, int r,
+        Bool* candidates) {
+    const OccupancyPyramid* pyramid = currentGame->pyramid;
+    int words = (currentGame->cols + 2 * currentGame->margin + 63) / 64;
+    memset(candidates, 0, sizeof(Bool) * words);
+    int top = pyramid->levelCount - 1;
+    for (int j = 0; j < pyramid->widths[top]; j++) {
+        mark_words(currentGame, markers, top, r + currentGame->margin, j,
+                candidates);
+    }
+    for (int w = 0; w < words; w++) {
+        if (candidates[w]) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "opening.h"
+#include "generate.h"
+
+/* Plays the first "plies" moves of a game in which automated player 3, with
+"searchMs" milliseconds a move, plays for "bookPlayer" against automated
+player "opponent" (player 3 plays both sides if "opponent" is 3). Stores an
+entry in "entries" for every move player 3 makes and returns their number. */
+long play_book_line(FitzGame* currentGame, int bookPlayer, int opponent,
+        int plies, int searchMs, FitzBookEntry* entries) {
+    long count = 0;
+    for (int ply = 0; ply < plies && !fitz_game_over(currentGame); ply++) {
+        FitzMove chosen;
+        if (opponent == 3 ||
+                fitz_game_next_player(currentGame) == bookPlayer) {
+            fitz_game_best_move(currentGame, searchMs, &chosen);
+            fitz_book_entry(currentGame, chosen, &entries[count++]);
+            fitz_game_play(currentGame, chosen);
+        } else {
+            fitz_game_auto_move(currentGame, opponent, &chosen);
+        }
+    }
+    return count;
+}
+
+/* Runs "fitz --build-book tilefile height width plies searchms bookfile":
+plays the openings of automated player 3 against automated players 1, 2 and
+3 on either side, searching "searchms" milliseconds a move, and writes the
+moves player 3 chose in the first "plies" moves to the book. Returns the
+program's exit status. */
+int run_book_builder(char** args, int argCount) {
+    long rows, cols, plies, searchMs;
+    if (argCount != 6 || !parse_count(args[1], 1, FITZ_MAX_DIMENSION, &rows) ||
+            !parse_count(args[2], 1, FITZ_MAX_DIMENSION, &cols) ||
+            !parse_count(args[3], 1, 1000, &plies) ||
+            !parse_count(args[4], 1, 3600000, &searchMs)) {
+        fprintf(stderr, "Usage: fitz --build-book tilefile height width "
+                "plies searchms bookfile\n");
+        return 1;
+    }
+    FitzTiles* tiles = load_tiles(args[0]);
+    FitzBookEntry* entries = malloc(sizeof(FitzBookEntry) *
+            OPENING_OPPONENTS * 2 * plies);
+    long count = 0;
+    for (int opponent = 1; opponent <= OPENING_OPPONENTS; opponent++) {
+        // player 3 against itself plays both sides already
+        int sides = opponent == 3 ? 1 : 2;
+        for (int bookPlayer = 0; bookPlayer < sides; bookPlayer++) {
+            FitzGame* currentGame;
+            fitz_game_new(tiles, (int)rows, (int)cols, &currentGame);
+            count += play_book_line(currentGame, bookPlayer, opponent,
+                    (int)plies, (int)searchMs, entries + count);
+            fitz_game_free(currentGame);
+        }
+    }
+    FitzError error = fitz_book_write(args[5], tiles, (int)rows, (int)cols,
+            entries, count);
+    free(entries);
+    FitzBook* book;
+    if (error == FITZ_OK) {
+        error = fitz_book_open(tiles, args[5], &book);
+    }
+    fitz_tiles_free(tiles);
+    if (error != FITZ_OK) {
+        exit_with_error(error);
+    }
+    printf("%ld positions\n", fitz_book_count(book));
+    fitz_book_free(book);
+    return 0;
+}
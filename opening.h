@@ -0,0 +1,14 @@
+#ifndef OPENING_H
+#define OPENING_H
+
+#include "head.h"
+
+// automated players the book's lines are played against
+#define OPENING_OPPONENTS 3
+
+//function prototypes
+int run_book_builder(char** args, int argCount);
+long play_book_line(FitzGame* currentGame, int bookPlayer, int opponent,
+        int plies, int searchMs, FitzBookEntry* entries);
+
+#endif
@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "perft.h"
+#include "timing.h"
+#include "generate.h"
+
+// the root moves of a perft run and the threads' share of the work
+typedef struct {
+    FitzMove* moves;
+    long* counts;           // sequences below each root move
+    long moveCount;
+    long nextMove;          // first root move no thread has taken yet
+    int depth;
+    long mismatches;        // positions failing the check, from all threads
+    pthread_mutex_t lock;
+} PerftJob;
+
+typedef struct {
+    PerftJob* job;
+    FitzEval* eval;         // the thread's own copy of the root position
+    const FitzGame* game;   // the root game when checking, otherwise NULL
+} PerftWorker;
+
+/* Counts the sequences of "depth" legal placements from the evaluator's
+position, with the tiles in their cyclic order and the players taking turns.
+A sequence that reaches a player who can't move ends early and isn't counted.
+The evaluator is left as it was. */
+long perft_count(FitzEval* eval, int depth) {
+    if (depth == 0) {
+        return 1;
+    }
+    if (depth == 1) {
+        // the evaluator keeps the counts of legal placements up to date
+        return fitz_eval_mobility(eval);
+    }
+    long total = 0;
+    FitzMove move;
+    long position = fitz_eval_next_legal(eval, 0, &move);
+    while (position >= 0) {
+        fitz_eval_place(eval, move);
+        total += perft_count(eval, depth - 1);
+        fitz_eval_undo(eval);
+        position = fitz_eval_next_legal(eval, position + 1, &move);
+    }
+    return total;
+}
+
+/* Checks that the legal map of the next tile agrees with the evaluator's
+legal placements, when the evaluator and "game" are in the same position.
+Returns 1 if they agree, otherwise 0. */
+static Bool legal_moves_agree(const FitzEval* eval, const FitzGame* game) {
+    int tile = fitz_eval_next_tile(eval);
+    FitzLegalMap map;
+    fitz_game_legal_map(game, &tile, 1, FITZ_ALL_ANGLES, &map);
+    long mapCount = 0;
+    for (int a = 0; a < 4; a++) {
+        mapCount += fitz_legal_map_count(&map, a);
+    }
+    // with equal counts, every placement of one is a placement of the other
+    Bool agree = mapCount == fitz_eval_mobility(eval);
+    FitzMove move;
+    long position = fitz_eval_next_legal(eval, 0, &move);
+    while (agree && position >= 0) {
+        agree = fitz_legal_map_test(&map, move.angle / 90, move.row,
+                move.col);
+        position = fitz_eval_next_legal(eval, position + 1, &move);
+    }
+    fitz_legal_map_free(&map);
+    return agree;
+}
+
+/* Counts like perft_count() the sequences of "depth" placements after "move",
+making each placement on a copy of "game" as well as on the evaluator, which
+is in the same position as "game". Every position reached is checked with
+legal_moves_agree(), and a placement that fitz_game_play() rejects fails the
+check too; the failures are added to "mismatches". The evaluator is left as
+it was. */
+static long perft_check(FitzEval* eval, const FitzGame* game, FitzMove move,
+        int depth, long* mismatches) {
+    FitzGame* child;
+    fitz_game_copy(game, &child);
+    if (fitz_game_play(child, move) != FITZ_OK) {
+        (*mismatches)++;
+    }
+    fitz_eval_place(eval, move);
+    if (!legal_moves_agree(eval, child)) {
+        (*mismatches)++;
+    }
+    long total = depth == 0 ? 1 : 0;
+    if (depth > 0) {
+        long position = fitz_eval_next_legal(eval, 0, &move);
+        while (position >= 0) {
+            total += perft_check(eval, child, move, depth - 1, mismatches);
+            position = fitz_eval_next_legal(eval, position + 1, &move);
+        }
+    }
+    fitz_eval_undo(eval);
+    fitz_game_free(child);
+    return total;
+}
+
+/* Takes root moves off a perft job one at a time until none are left,
+counting the sequences below each, and checking them if the worker has a
+game. */
+static void* perft_worker(void* arg) {
+    PerftWorker* worker = arg;
+    PerftJob* job = worker->job;
+    long mismatches = 0;
+    while (1) {
+        pthread_mutex_lock(&job->lock);
+        long i = job->nextMove++;
+        if (i >= job->moveCount) {
+            job->mismatches += mismatches;
+        }
+        pthread_mutex_unlock(&job->lock);
+        if (i >= job->moveCount) {
+            return NULL;
+        }
+        if (worker->game != NULL) {
+            job->counts[i] = perft_check(worker->eval, worker->game,
+                    job->moves[i], job->depth - 1, &mismatches);
+            continue;
+        }
+        fitz_eval_place(worker->eval, job->moves[i]);
+        job->counts[i] = perft_count(worker->eval, job->depth - 1);
+        fitz_eval_undo(worker->eval);
+    }
+}
+
+/* Sets up the position for "fitz --perft": a new game if "args" are a tile
+file, height and width, or a saved game if they are a tile file and save file.
+Exits the program if the position can't be set up. */
+static FitzGame* perft_position(FitzTiles* tiles, char** args, int argCount) {
+    FitzGame* currentGame;
+    FitzError error;
+    if (argCount == 3) {
+        long rows, cols;
+        if (!parse_count(args[1], 1, FITZ_MAX_DIMENSION, &rows) ||
+                !parse_count(args[2], 1, FITZ_MAX_DIMENSION, &cols)) {
+            rows = 0;
+        }
+        error = fitz_game_new(tiles, (int)rows, (int)cols, &currentGame);
+    } else {
+        error = fitz_game_load(tiles, args[1], &currentGame);
+    }
+    if (error != FITZ_OK) {
+        fitz_tiles_free(tiles);
+        exit_with_error(error);
+    }
+    return currentGame;
+}
+
+/* Runs "fitz --perft [-j threads] [--check] tilefile (height width |
+savefile) depth": counts the sequences of "depth" legal placements from the
+position and prints the count below each first move, in row, column and
+rotation order, and then the total. The first moves are shared out among the
+threads (by default one per processor); the time taken goes to standard
+error. With "--check" every placement is also made on a game, and every
+position's legal map is compared with the evaluator's legal placements.
+Returns the program's exit status. */
+int run_perft(char** args, int argCount) {
+    long threadCount = sysconf(_SC_NPROCESSORS_ONLN);
+    Bool valid = 1;
+    Bool check = 0;
+    while (valid && argCount >= 1) {
+        if (argCount >= 2 && strcmp(args[0], "-j") == 0) {
+            valid = parse_count(args[1], 1, PERFT_MAX_THREADS,
+                    &threadCount);
+            args += 2;
+            argCount -= 2;
+        } else if (strcmp(args[0], "--check") == 0) {
+            check = 1;
+            args++;
+            argCount--;
+        } else {
+            break;
+        }
+    }
+    long depth;
+    if (!valid || argCount < 3 || argCount > 4 || threadCount < 1 ||
+            !parse_count(args[argCount - 1], 0, 64, &depth)) {
+        fprintf(stderr, "Usage: fitz --perft [-j threads] [--check] "
+                "tilefile (height width | savefile) depth\n");
+        return 1;
+    }
+    FitzTiles* tiles = load_tiles(args[0]);
+    FitzGame* currentGame = perft_position(tiles, args, argCount - 1);
+    double start = fitz_now_millis();
+
+    PerftJob job;
+    job.depth = (int)depth;
+    job.moveCount = 0;
+    job.nextMove = 0;
+    job.mismatches = 0;
+    pthread_mutex_init(&job.lock, NULL);
+    PerftWorker* workers = malloc(sizeof(PerftWorker) * threadCount);
+    FitzError error = fitz_eval_new(currentGame, &workers[0].eval);
+    if (error != FITZ_OK) {
+        fprintf(stderr, "%s\n", fitz_error_message(error));
+        free(workers);
+        fitz_game_free(currentGame);
+        fitz_tiles_free(tiles);
+        return error;
+    }
+    workers[0].game = check ? currentGame : NULL;
+    if (check && !legal_moves_agree(workers[0].eval, currentGame)) {
+        job.mismatches++;
+    }
+    long total = 1;
+    if (depth > 0) {
+        FitzEval* root = workers[0].eval;
+        job.moves = malloc(sizeof(FitzMove) *
+                (fitz_eval_mobility(root) + 1));
+        FitzMove move;
+        long position = fitz_eval_next_legal(root, 0, &move);
+        while (position >= 0) {
+            job.moves[job.moveCount++] = move;
+            position = fitz_eval_next_legal(root, position + 1, &move);
+        }
+        job.counts = malloc(sizeof(long) * (job.moveCount + 1));
+        if (threadCount > job.moveCount) {
+            threadCount = job.moveCount > 0 ? job.moveCount : 1;
+        }
+        pthread_t* threads = malloc(sizeof(pthread_t) * threadCount);
+        for (int i = 0; i < threadCount; i++) {
+            workers[i].job = &job;
+            if (i > 0) {
+                fitz_eval_new(currentGame, &workers[i].eval);
+                workers[i].game = workers[0].game;
+                pthread_create(&threads[i], NULL, perft_worker, &workers[i]);
+            }
+        }
+        perft_worker(&workers[0]);
+        for (int i = 1; i < threadCount; i++) {
+            pthread_join(threads[i], NULL);
+            fitz_eval_free(workers[i].eval);
+        }
+        total = 0;
+        for (long i = 0; i < job.moveCount; i++) {
+            printf("%d %d rotated %d: %ld\n", job.moves[i].row,
+                    job.moves[i].col, job.moves[i].angle, job.counts[i]);
+            total += job.counts[i];
+        }
+        free(threads);
+        free(job.counts);
+        free(job.moves);
+    }
+    printf("Nodes: %ld\n", total);
+    if (check) {
+        printf("Mismatches: %ld\n", job.mismatches);
+    }
+    double seconds = (fitz_now_millis() - start) / 1000;
+    fprintf(stderr, "Depth %ld: %ld nodes in %.3f s (%.0f nodes/s, "
+            "%ld threads)\n", depth, total, seconds,
+            seconds > 0 ? total / seconds : 0.0, threadCount);
+
+    pthread_mutex_destroy(&job.lock);
+    fitz_eval_free(workers[0].eval);
+    free(workers);
+    fitz_game_free(currentGame);
+    fitz_tiles_free(tiles);
+    return job.mismatches > 0 ? PERFT_MISMATCH_STATUS : 0;
+}
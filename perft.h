@@ -0,0 +1,15 @@
+#ifndef PERFT_H
+#define PERFT_H
+
+#include "head.h"
+
+// the most threads a perft run splits its root moves among
+#define PERFT_MAX_THREADS 256
+// exit status of "fitz --perft --check" when any position fails the check
+#define PERFT_MISMATCH_STATUS 31
+
+//function prototypes
+int run_perft(char** args, int argCount);
+long perft_count(FitzEval* eval, int depth);
+
+#endif
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "internal.h"
+
+
+/* Creates the "recentPlays" array: element 0 contains the most recent move by
+player 0 stored in an int array in the format {r, c}; element 1 for player 1;
+element 2 for either. No move is recorded as {-10, -10}. */
+int** new_recent_plays(void) {
+    int** recentPlays = malloc(sizeof(int*) * 3);
+    for (int i = 0; i < 3; i++) {
+        recentPlays[i] = malloc(sizeof(int) * 2);
+        recentPlays[i][0] = -10; //initialise to -10
+        recentPlays[i][1] = -10; //initialise to -10
+    }
+    return recentPlays;
+}
+
+/* A function that frees a "recentPlays" 2D array. */
+void free_mem_recent_plays(int** recentPlays) {
+    for (int i = 0; i < 3; i++) {
+        free(recentPlays[i]);
+    }
+    free(recentPlays);
+}
+
+/* Records a move at row r and column c by "player" in "recentPlays". */
+void record_play(int** recentPlays, int player, int r, int c) {
+    recentPlays[player][0] = r;
+    recentPlays[player][1] = c;
+    recentPlays[2][0] = r;
+    recentPlays[2][1] = c;
+}
+
+/* Converts a human player's input into integers that represent a move and
+returns this information as an int array. Returns NULL if invalid format. */
+int* get_human_input(const char* input) {
+    int parameterCounter = 0;
+    int length = strlen(input);
+    // check for shorter than minimum length
+    if (length < 5) {
+        return NULL;
+    }
+    // check for trailing space
+    if (input[length - 1] == ' ') {
+        return NULL;
+    }
+    // a str array containing the human player's three numbers (but as a str)
+    char** resultStrs = malloc(sizeof(char*) * 3);
+    for (int i = 0; i < 3; i++) {
+        resultStrs[i] = malloc(sizeof(char) * 71);
+    }
+
+    int j = 0;
+    for(int i = 0; i <= length; i++) {
+        if (input[i] == ' ' || input[i] == '\0') {
+            resultStrs[parameterCounter][j] = '\0';
+            parameterCounter++;
+            j = 0;
+        } else if (parameterCounter >= 3) {
+            free_input_mem(resultStrs);
+            return NULL;
+        } else {
+            if (isdigit(input[i]) || input[i] == '-') {
+                resultStrs[parameterCounter][j] = input[i];
+                j++;
+            } else {
+                free_input_mem(resultStrs);
+                return NULL;
+            }
+        }
+    }
+
+    if (parameterCounter != 3) {
+        free_input_mem(resultStrs);
+        return NULL;
+    }
+
+    int* resultInts = malloc(sizeof(int) * 3);
+    resultInts[0] = strtol(resultStrs[0], NULL, 10);
+    resultInts[1] = strtol(resultStrs[1], NULL, 10);
+    resultInts[2] = strtol(resultStrs[2], NULL, 10);
+    free_input_mem(resultStrs);
+    return resultInts;
+}
+
+/* Frees the "input" array used in the function get_human_input().  */
+void free_input_mem(char** resultStrs) {
+    for (int i = 0; i < 3; i++) {
+        free(resultStrs[i]);
+    }
+    free(resultStrs);
+}
+
+/* Assigns rStart and cStart values for automated player 1. */
+void a1_assign_initial_values(Game* currentGame, int** recentPlays, int* r,
+        int* c) {
+    int* mostRecentPlay = recentPlays[2];
+    int rStart;
+    int cStart;
+    if (mostRecentPlay[0] == -10 || mostRecentPlay[1] == -10) {
+        rStart = -currentGame->margin;
+        cStart = -currentGame->margin;
+    } else {
+        rStart = mostRecentPlay[0];
+        cStart = mostRecentPlay[1];
+    }
+    *r = rStart;
+    *c = cStart;
+}
+
+/* Places the next tile at anchor (r, c) rotated by "theta" for automated
+player 1 or 2, storing the move in "chosen". Returns 0 if it fits, otherwise
+1. */
+static int make_automated_move(Game* currentGame, const FitzTiles* library,
+        int** recentPlays, int r, int c, int theta, FitzMove* chosen) {
+    const TileShape* shape = &library->shapes[currentGame->nextTile * 4 +
+            theta / 90];
+    if (!tile_fits(currentGame, shape, r, c)) {
+        return 1;
+    }
+    put_tile(currentGame, shape, currentGame->nextPlayer, r, c);
+    record_play(recentPlays, currentGame->nextPlayer, r, c);
+    chosen->row = r;
+    chosen->col = c;
+    chosen->angle = theta;
+    return 0;
+}
+
+/* Processes automated player 1's moves, storing the move made in "chosen".
+Player 1 tries each rotation in turn, scanning the whole board row by row from
+the most recent move for it. Returns 1 if the tile can't be placed anywhere. */
+int automated_move_1(Game* currentGame, const FitzTiles* library,
+        int** recentPlays, FitzMove* chosen) {
+    const TileShape* shapes = library->shapes + currentGame->nextTile * 4;
+    int rStart, cStart, r, c;
+    a1_assign_initial_values(currentGame, recentPlays, &rStart, &cStart);
+    for (int theta = 0; theta <= 270; theta += 90) {
+        if (first_legal_anchor(currentGame, shapes, FITZ_ANGLE_BIT(theta),
+                rStart, cStart, 1, &r, &c)) {
+            return make_automated_move(currentGame, library, recentPlays, r,
+                    c, theta, chosen);
+        }
+    }
+    return 1;
+}
+
+/* Assigns rStart and cStart values for automated player 2. */
+void a2_assign_initial_values(Game* currentGame, int** recentPlays, int* r,
+        int* c) {
+    int boardLength = currentGame->cols;
+    int boardHeight = currentGame->rows;
+    int player = currentGame->nextPlayer;
+    int* mostRecentPlay = recentPlays[player];
+    int rStart;
+    int cStart;
+    if (mostRecentPlay[0] == -10 || mostRecentPlay[1] == -10) {
+        if (player == 0) {
+            rStart = -currentGame->margin;
+            cStart = -currentGame->margin;
+        } else {
+            rStart = boardHeight + currentGame->margin - 1;
+            cStart = boardLength + currentGame->margin - 1;
+        }
+    } else {
+        rStart = mostRecentPlay[0];
+        cStart = mostRecentPlay[1];
+    }
+    *r = rStart;
+    *c = cStart;
+}
+
+/* Processes automated player 2's moves, storing the move made in "chosen".
+Player 2 scans row by row from its own last move (forwards for player *,
+backwards for player #) and takes the first anchor where some rotation fits,
+in the smallest such rotation. Returns 1 if the tile can't be placed
+anywhere. */
+int automated_move_2(Game* currentGame, const FitzTiles* library,
+        int** recentPlays, FitzMove* chosen) {
+    const TileShape* shapes = library->shapes + currentGame->nextTile * 4;
+    int rStart, cStart, r, c;
+    a2_assign_initial_values(currentGame, recentPlays, &rStart, &cStart);
+    if (!first_legal_anchor(currentGame, shapes, FITZ_ALL_ANGLES, rStart,
+            cStart, currentGame->nextPlayer == 0 ? 1 : -1, &r, &c)) {
+        return 1;
+    }
+    for (int theta = 0; theta <= 270; theta += 90) {
+        if (make_automated_move(currentGame, library, recentPlays, r, c,
+                theta, chosen) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
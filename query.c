@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "query.h"
+
+/* Runs "fitz --legal tilefile savefile [tile ...]": prints, for each listed
+tile (or the saved game's next tile if none are listed) in each rotation, the
+legal anchors for the player to move over rows -margin to height + margin - 1
+and columns -margin to width + margin - 1, where the margin is half the tile
+size. Returns the program's exit status. */
+int run_legal_query(char** args, int argCount) {
+    if (argCount < 2) {
+        fprintf(stderr, "Usage: fitz --legal tilefile savefile [tile ...]\n");
+        return 1;
+    }
+    FitzTiles* tiles = load_tiles(args[0]);
+    FitzGame* currentGame;
+    FitzError error = fitz_game_load(tiles, args[1], &currentGame);
+    if (error != FITZ_OK) {
+        fitz_tiles_free(tiles);
+        exit_with_error(error);
+    }
+    int tileCount = argCount - 2;
+    int* tileIndexes = malloc(sizeof(int) * (tileCount > 0 ? tileCount : 1));
+    for (int i = 0; i < tileCount; i++) {
+        char* end;
+        long value = strtol(args[i + 2], &end, 10);
+        tileIndexes[i] = (*end != '\0' || end == args[i + 2] || value < 0 ||
+                value >= fitz_tiles_count(tiles)) ? -1 : (int)value;
+    }
+    if (tileCount == 0) {
+        tileIndexes[0] = fitz_game_next_tile(currentGame);
+        tileCount = 1;
+    }
+
+    FitzLegalMap map;
+    error = fitz_game_legal_map(currentGame, tileIndexes, tileCount,
+            FITZ_ALL_ANGLES, &map);
+    if (error == FITZ_OK) {
+        for (int i = 0; i < map.count; i++) {
+            printf("Tile %d rotated %d: %ld legal\n", tileIndexes[i / 4],
+                    (i % 4) * 90, fitz_legal_map_count(&map, i));
+            print_legal_map(&map, i, stdout);
+        }
+        fitz_legal_map_free(&map);
+    } else {
+        fprintf(stderr, "%s\n", fitz_error_message(error));
+    }
+    free(tileIndexes);
+    fitz_game_free(currentGame);
+    fitz_tiles_free(tiles);
+    return error;
+}
+
+/* Writes bitmap "index" of a legal map to "out", one line per anchor row with
+'1' for a legal anchor and '0' otherwise. */
+void print_legal_map(const FitzLegalMap* map, int index, FILE* out) {
+    char* line = malloc(map->width + 2);
+    for (int y = 0; y < map->height; y++) {
+        for (int x = 0; x < map->width; x++) {
+            line[x] = fitz_legal_map_test(map, index, y - map->margin,
+                    x - map->margin) ? '1' : '0';
+        }
+        line[map->width] = '\n';
+        line[map->width + 1] = '\0';
+        fputs(line, out);
+    }
+    free(line);
+}
@@ -0,0 +1,10 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include "head.h"
+
+//function prototypes
+int run_legal_query(char** args, int argCount);
+void print_legal_map(const FitzLegalMap* map, int index, FILE* out);
+
+#endif
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "render.h"
+
+/* With "--pipeline", a game between automated or engine players is shown by an
+output thread, so that the game thread never waits for a slow terminal or
+pipe. The game thread only queues each move (a few bytes) on a ring, and the
+output thread plays the moves on its own copy of the game and prints what
+play_game() would have printed, writing standard output in large blocks
+whenever it catches up. The ring has one writer and one reader, so it needs no
+lock: each side owns one counter and publishes it with a release store after
+touching the slot. The game thread only stops when the ring is full. */
+
+struct Renderer {
+    RenderEvent ring[RENDER_RING_SIZE];
+    unsigned long written;  // moves queued so far (set by the game thread)
+    unsigned long read;     // moves shown so far (set by the output thread)
+    Bool finished;          // no more moves are coming
+    FitzGame* shown;        // the game as the output thread has shown it
+    char* playerTypes[2];
+    Options display;    // the viewport the board is shown through
+    FILE* out;
+    pthread_t thread;
+};
+
+/* Checks whether a game can be shown by an output thread: the output is text
+and no player is human, so there is no prompt or input to keep in step with
+the moves shown. Returns 1 if so, otherwise 0. */
+Bool can_pipeline(char* pType1, char* pType2, Options* options) {
+    return options->output == OUTPUT_TEXT &&
+            options->script == NULL && strcmp(pType1, "h") != 0 &&
+            strcmp(pType2, "h") != 0;
+}
+
+/* Sleeps while the other thread catches up. */
+static void wait_a_moment(void) {
+    struct timespec pause = {0, RENDER_WAIT_MICROS * 1000L};
+    nanosleep(&pause, NULL);
+}
+
+/* Shows a move as play_game() does: the automated player's move, the board
+and (for a human player) the next tile. */
+static void render_move(Renderer* renderer, RenderEvent event) {
+    FitzMove move = {event.row, event.col, event.turns * 90};
+    fitz_game_play(renderer->shown, move);
+    if (strcmp(renderer->playerTypes[event.player], "h") != 0) {
+        automated_display(event.player, move.row, move.col, move.angle,
+                renderer->out);
+    }
+    display_board(renderer->shown, &renderer->display, renderer->out);
+    display_next_tile(renderer->playerTypes[0], renderer->playerTypes[1],
+            renderer->shown, renderer->out);
+}
+
+/* The output thread: shows the queued moves as they come, flushing the output
+each time it runs out of them, until the game thread has finished. */
+static void* render_moves(void* arg) {
+    Renderer* renderer = arg;
+    unsigned long read = renderer->read;
+    while (1) {
+        // the last move is queued before "finished" is set
+        Bool finished = __atomic_load_n(&renderer->finished,
+                __ATOMIC_ACQUIRE);
+        unsigned long written = __atomic_load_n(&renderer->written,
+                __ATOMIC_ACQUIRE);
+        if (read == written) {
+            fflush(renderer->out);
+            if (finished) {
+                break;
+            }
+            wait_a_moment();
+            continue;
+        }
+        while (read != written) {
+            render_move(renderer,
+                    renderer->ring[read % RENDER_RING_SIZE]);
+            read++;
+            __atomic_store_n(&renderer->read, read, __ATOMIC_RELEASE);
+        }
+    }
+    return NULL;
+}
+
+/* Starts an output thread showing the moves of a game from its current
+position on "out", which it writes in large blocks. Nothing else may write to
+"out" until renderer_finish(). */
+Renderer* renderer_start(const FitzGame* currentGame, char* pType1,
+        char* pType2, Options* options, FILE* out) {
+    Renderer* renderer = malloc(sizeof(Renderer));
+    renderer->written = 0;
+    renderer->read = 0;
+    renderer->finished = 0;
+    fitz_game_copy(currentGame, &renderer->shown);
+    renderer->playerTypes[0] = pType1;
+    renderer->playerTypes[1] = pType2;
+    renderer->display = *options;
+    renderer->out = out;
+    pthread_create(&renderer->thread, NULL, render_moves, renderer);
+    return renderer;
+}
+
+/* Queues a move for the output thread, waiting only if the ring is full. */
+void renderer_push(Renderer* renderer, int player, FitzMove move) {
+    unsigned long written = renderer->written;
+    while (written - __atomic_load_n(&renderer->read, __ATOMIC_ACQUIRE) ==
+            RENDER_RING_SIZE) {
+        wait_a_moment();
+    }
+    RenderEvent* event = &renderer->ring[written % RENDER_RING_SIZE];
+    event->row = move.row;
+    event->col = move.col;
+    event->player = player;
+    event->turns = move.angle / 90;
+    __atomic_store_n(&renderer->written, written + 1, __ATOMIC_RELEASE);
+}
+
+/* Waits for the output thread to show every queued move and flush its
+output, then frees it. */
+void renderer_finish(Renderer* renderer) {
+    __atomic_store_n(&renderer->finished, 1, __ATOMIC_RELEASE);
+    pthread_join(renderer->thread, NULL);
+    fitz_game_free(renderer->shown);
+    free(renderer);
+}
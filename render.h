@@ -0,0 +1,32 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdint.h>
+#include "head.h"
+
+// moves the game thread may get ahead of the output thread (a power of two)
+#define RENDER_RING_SIZE 4096
+// how long either thread sleeps when it has to wait for the other
+#define RENDER_WAIT_MICROS 500
+// size of standard output's buffer while the output thread writes it
+#define RENDER_BUFFER_SIZE 65536
+
+// a move passed to the output thread
+typedef struct {
+    int16_t row;
+    int16_t col;
+    uint8_t player;
+    uint8_t turns;          // the rotation in quarter turns
+} RenderEvent;
+
+// an output thread with its ring of moves (see render.c)
+typedef struct Renderer Renderer;
+
+//function prototypes
+Bool can_pipeline(char* pType1, char* pType2, Options* options);
+Renderer* renderer_start(const FitzGame* currentGame, char* pType1,
+        char* pType2, Options* options, FILE* out);
+void renderer_push(Renderer* renderer, int player, FitzMove move);
+void renderer_finish(Renderer* renderer);
+
+#endif
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "script.h"
+
+/* A move script holds the human players' moves, one "row column rotate" line
+each, as they would be typed. It is mapped into memory and parsed in a single
+pass into one array of moves, so that thousands of moves cost no allocation or
+prompt apiece. Empty lines are skipped. */
+
+/* Parses a number of at most SCRIPT_MAX_DIGITS digits, with an optional
+leading '-', from "*position" on, stopping before "end". Moves "*position"
+past it. Returns 0 if there is no such number. */
+static Bool parse_script_number(const char** position, const char* end,
+        int* value) {
+    const char* next = *position;
+    int sign = 1;
+    if (next < end && *next == '-') {
+        sign = -1;
+        next++;
+    }
+    const char* digits = next;
+    int number = 0;
+    while (next < end && *next >= '0' && *next <= '9' &&
+            next - digits < SCRIPT_MAX_DIGITS) {
+        number = number * 10 + (*next - '0');
+        next++;
+    }
+    if (next == digits) {
+        return 0;
+    }
+    *value = sign * number;
+    *position = next;
+    return 1;
+}
+
+/* Parses the line from "line" to "end" (without its newline) as a move.
+Returns 0 if it is malformed. */
+static Bool parse_script_line(const char* line, const char* end,
+        FitzMove* move) {
+    int* fields[3] = {&move->row, &move->col, &move->angle};
+    for (int i = 0; i < 3; i++) {
+        if (i > 0) {
+            if (line == end || *line != ' ') {
+                return 0;
+            }
+            line++;
+        }
+        if (!parse_script_number(&line, end, fields[i])) {
+            return 0;
+        }
+    }
+    return line == end;
+}
+
+/* Maps the move script at "path" and parses all of its moves. Returns the
+script, or NULL with "*badLine" set to the number of the first malformed line
+(or 0 if the file can't be read). */
+MoveScript* load_move_script(const char* path, long* badLine) {
+    *badLine = 0;
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd == -1 || fstat(fd, &info) == -1) {
+        if (fd != -1) {
+            close(fd);
+        }
+        return NULL;
+    }
+    const char* data = NULL;
+    if (info.st_size > 0) {
+        data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    // every move takes at least six characters ("0 0 0\n"), so one
+    // allocation holds them all
+    long capacity = info.st_size / 6 + 1;
+    MoveScript* script = malloc(sizeof(MoveScript));
+    script->moves = malloc(sizeof(FitzMove) * capacity);
+    script->lines = malloc(sizeof(long) * capacity);
+    script->count = 0;
+    script->next = 0;
+    const char* position = data;
+    const char* end = data + info.st_size;
+    long lineNumber = 0;
+    while (position < end) {
+        const char* newline = memchr(position, '\n', end - position);
+        const char* lineEnd = newline == NULL ? end : newline;
+        lineNumber++;
+        if (lineEnd != position) {
+            if (!parse_script_line(position, lineEnd,
+                    &script->moves[script->count])) {
+                *badLine = lineNumber;
+                break;
+            }
+            script->lines[script->count++] = lineNumber;
+        }
+        position = lineEnd + 1;
+    }
+    if (data != NULL) {
+        munmap((void*)data, info.st_size);
+    }
+    if (*badLine != 0) {
+        free_move_script(script);
+        return NULL;
+    }
+    return script;
+}
+
+/* Frees a move script. */
+void free_move_script(MoveScript* script) {
+    free(script->moves);
+    free(script->lines);
+    free(script);
+}
+
+/* Checks whether a move script (which may be NULL) has moves left to play.
+Returns 1 if yes, otherwise 0. */
+Bool script_has_moves(const MoveScript* script) {
+    return script != NULL && script->next < script->count;
+}
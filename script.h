@@ -0,0 +1,17 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include "head.h"
+
+// exit statuses for a move script that can't be read or has a malformed line
+#define SCRIPT_ACCESS_STATUS 27
+#define SCRIPT_CONTENTS_STATUS 28
+// longest number a move script line may hold, in digits
+#define SCRIPT_MAX_DIGITS 9
+
+//function prototypes
+MoveScript* load_move_script(const char* path, long* badLine);
+void free_move_script(MoveScript* script);
+Bool script_has_moves(const MoveScript* script);
+
+#endif
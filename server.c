@@ -0,0 +1,619 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include "server.h"
+#include "engine.h"
+
+static volatile sig_atomic_t stopServer = 0;
+
+/* Signal handler asking the event loop to shut down. */
+static void request_stop(int signal) {
+    (void)signal;
+    stopServer = 1;
+}
+
+/* Puts a file descriptor into non-blocking mode. Returns 0 on success. */
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/* Splits "line" in place on single spaces, storing at most "max" words.
+Returns the number of words found (which may exceed "max"). */
+static int split_words(char* line, char** words, int max) {
+    int count = 0;
+    char* save = NULL;
+    for (char* word = strtok_r(line, " ", &save); word != NULL;
+            word = strtok_r(NULL, " ", &save)) {
+        if (count < max) {
+            words[count] = word;
+        }
+        count++;
+    }
+    return count;
+}
+
+/* Parses a board dimension, returning -1 if it is not a whole number. */
+static int parse_dimension(char* text) {
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || value > FITZ_MAX_DIMENSION) {
+        return -1;
+    }
+    return (int)value;
+}
+
+/* Returns the shared tile library of a tile file given on the command line,
+or NULL if "path" isn't one of them. */
+static FitzTiles* served_library(Server* server, char* path) {
+    for (int i = 0; i < server->librariesCount; i++) {
+        if (strcmp(server->libraries[i].path, path) == 0) {
+            return server->libraries[i].tiles;
+        }
+    }
+    return NULL;
+}
+
+/* Loads a tile file given on the command line, so that sessions may play with
+it. Returns 0 and writes the CLI's error message to stderr if it can't be
+loaded, otherwise 1. */
+static Bool add_library(Server* server, char* path) {
+    if (served_library(server, path) != NULL) {
+        return 1;
+    }
+    FitzTiles* tiles;
+    FitzError error = fitz_tiles_load(path, &tiles);
+    if (error != FITZ_OK) {
+        fprintf(stderr, "%s\n", fitz_error_message(error));
+        return 0;
+    }
+    server->libraries = realloc(server->libraries,
+            sizeof(TileLibrary) * (server->librariesCount + 1));
+    TileLibrary* library = &server->libraries[server->librariesCount++];
+    library->path = strdup(path);
+    library->tiles = tiles;
+    return 1;
+}
+
+/* Returns the shared tile library a session asked for. Sessions may only use
+the tile files given on the command line, so that a client can't make the
+server open other files; for any other path this returns NULL and writes an
+error to "out". */
+static FitzTiles* find_library(Server* server, char* path, FILE* out) {
+    FitzTiles* tiles = served_library(server, path);
+    if (tiles == NULL) {
+        fprintf(out, "Tile file not served\n");
+    }
+    return tiles;
+}
+
+/* Returns the path of the save file "name" in the server's save directory,
+to be freed by the caller. Sessions may only save and load plain file names
+in the directory given with --save-dir, so that a client can't make the
+server read or write other files; without that directory, or for a name with
+a "/" or that is "." or "..", this returns NULL and writes an error to
+"out". */
+static char* find_save_path(Server* server, const char* name, FILE* out) {
+    if (server->saveDir == NULL || name[0] == '\0' ||
+            strchr(name, '/') != NULL || strcmp(name, ".") == 0 ||
+            strcmp(name, "..") == 0) {
+        fprintf(out, "Save file not served\n");
+        return NULL;
+    }
+    char* path = malloc(strlen(server->saveDir) + strlen(name) + 2);
+    sprintf(path, "%s/%s", server->saveDir, name);
+    return path;
+}
+
+/* Records one latency sample (in microseconds) against a session. */
+static void record_latency(LatencyStats* stats, double micros) {
+    int bucket = 0;
+    while (bucket < SERVER_LATENCY_BUCKETS - 1 && (1L << bucket) <= micros) {
+        bucket++;
+    }
+    stats->buckets[bucket]++;
+    stats->samples++;
+    stats->totalMicros += micros;
+    if (micros > stats->maxMicros) {
+        stats->maxMicros = micros;
+    }
+}
+
+/* Returns an upper bound (in microseconds) of the given latency percentile. */
+static long latency_percentile(LatencyStats* stats, double percentile) {
+    if (stats->samples == 0) {
+        return 0;
+    }
+    long target = (long)(stats->samples * percentile);
+    long seen = 0;
+    for (int i = 0; i < SERVER_LATENCY_BUCKETS; i++) {
+        seen += stats->buckets[i];
+        if (seen > target) {
+            return 1L << i;
+        }
+    }
+    return 1L << (SERVER_LATENCY_BUCKETS - 1);
+}
+
+/* Writes a one line summary of a session's latency to "out". */
+static void print_latency(Session* session, FILE* out) {
+    LatencyStats* stats = &session->latency;
+    double mean = stats->samples ? stats->totalMicros / stats->samples : 0;
+    fprintf(out, "Session %d latency: commands=%ld mean=%.1fus p50<=%ldus "
+            "p99<=%ldus max=%.1fus\n", session->id, stats->samples, mean,
+            latency_percentile(stats, 0.5), latency_percentile(stats, 0.99),
+            stats->maxMicros);
+}
+
+/* Creates a listening Unix domain socket bound to "path". Returns its file
+descriptor, or -1 on failure. */
+static int server_listen(char* path) {
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) == -1 ||
+            listen(fd, SOMAXCONN) == -1 || set_nonblocking(fd) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Appends a session to the back of the queue of sessions owing a bot move. */
+static void queue_ready(Server* server, Session* session) {
+    if (session->queued) {
+        return;
+    }
+    session->queued = 1;
+    session->nextReady = NULL;
+    if (server->readyTail == NULL) {
+        server->readyHead = session;
+    } else {
+        server->readyTail->nextReady = session;
+    }
+    server->readyTail = session;
+}
+
+/* Frees the game currently held by a session, if any. */
+static void session_end_game(Session* session) {
+    if (session->game != NULL) {
+        fitz_game_free(session->game);
+        session->game = NULL;
+    }
+    session->state = SESSION_IDLE;
+}
+
+/* Disconnects a session. The session itself is freed here unless it is still
+on the ready queue, in which case the queue runner frees it. */
+static void session_close(Server* server, Session* session) {
+    print_latency(session, stderr);
+    epoll_ctl(server->epollFd, EPOLL_CTL_DEL, session->fd, NULL);
+    close(session->fd);
+    session->fd = -1;
+    session_end_game(session);
+    session->state = SESSION_CLOSING;
+    fclose(session->out);
+    free(session->outBuffer);
+    session->out = NULL;
+    server->sessionsOpen--;
+    if (!session->queued) {
+        free(session);
+    }
+}
+
+/* Registers interest in input only while the session is waiting for a command
+(so lines sent during automated moves stay buffered) and in output only while
+some is pending. */
+static void session_watch(Server* server, Session* session) {
+    unsigned int events = 0;
+    if (session->state == SESSION_HUMAN || session->state == SESSION_IDLE) {
+        events |= EPOLLIN;
+    }
+    if (session->outSent < session->outLength) {
+        events |= EPOLLOUT;
+    }
+    if (events != session->events) {
+        struct epoll_event event = {events, {session}};
+        epoll_ctl(server->epollFd, EPOLL_CTL_MOD, session->fd, &event);
+        session->events = events;
+    }
+}
+
+/* Sends as much pending output as the socket accepts. Returns 1 if the session
+was closed (because of an error or because it finished closing). */
+static Bool session_flush(Server* server, Session* session) {
+    fflush(session->out);
+    while (session->outSent < session->outLength) {
+        ssize_t sent = send(session->fd, session->outBuffer + session->outSent,
+                session->outLength - session->outSent, MSG_NOSIGNAL);
+        if (sent == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                session_close(server, session);
+                return 1;
+            }
+            session_watch(server, session);
+            return 0;
+        }
+        session->outSent += sent;
+    }
+
+    // everything written - start a fresh output stream
+    fclose(session->out);
+    free(session->outBuffer);
+    session->outBuffer = NULL;
+    session->outLength = 0;
+    session->outSent = 0;
+    session->out = open_memstream(&session->outBuffer, &session->outLength);
+    if (session->pendingCommands > 0 && session->state != SESSION_BOT) {
+        double micros = fitz_now_millis() * 1e3 - session->pendingSince;
+        for (int i = 0; i < session->pendingCommands; i++) {
+            record_latency(&session->latency, micros);
+        }
+        session->pendingCommands = 0;
+    }
+    if (session->state == SESSION_CLOSING) {
+        session_close(server, session);
+        return 1;
+    }
+    session_watch(server, session);
+    return 0;
+}
+
+/* Starts the current player's turn: prompts a human player, unless the game
+is over and a winner is declared, or queues an automated player (whose step
+finds out whether the game is over). */
+static void session_begin_turn(Server* server, Session* session) {
+    int player = fitz_game_next_player(session->game);
+    FitzStep step;
+    if (strcmp(session->playerTypes[player], "h") != 0) {
+        session->state = SESSION_BOT;
+        queue_ready(server, session);
+    } else if (fitz_game_step(session->game, NULL, &step) ==
+            FITZ_STEP_GAME_OVER) {
+        print_winner(player, session->out);
+        session_end_game(session);
+    } else {
+        prompt_player(player, session->out);
+        session->state = SESSION_HUMAN;
+    }
+}
+
+/* Displays the board after a successful move, as the CLI does, and starts
+the other player's turn. */
+static void session_finish_turn(Server* server, Session* session) {
+    fitz_game_print(session->game, session->out);
+    display_next_tile(session->playerTypes[0], session->playerTypes[1],
+            session->game, session->out);
+    session_begin_turn(server, session);
+}
+
+/* Handles "new tilefile p1type p2type height width" and
+"load tilefile p1type p2type savefile". */
+static void session_start_game(Server* server, Session* session, char** words,
+        int wordCount) {
+    Bool isNew = strcmp(words[0], "new") == 0;
+    if (wordCount != (isNew ? 6 : 5)) {
+        fprintf(session->out, "Invalid command\n");
+        return;
+    }
+    FitzTiles* tiles = find_library(server, words[1], session->out);
+    if (tiles == NULL) {
+        return;
+    }
+    // external engines would block the event loop, so only the built-in
+    // player types are served
+    if (!valid_player_types(words[2], words[3]) || is_engine_type(words[2])
+            || is_engine_type(words[3])) {
+        fprintf(session->out, "Invalid player type\n");
+        return;
+    }
+    FitzError error;
+    if (isNew) {
+        error = fitz_game_new(tiles, parse_dimension(words[4]),
+                parse_dimension(words[5]), &session->game);
+    } else {
+        char* savePath = find_save_path(server, words[4], session->out);
+        if (savePath == NULL) {
+            return;
+        }
+        error = fitz_game_load(tiles, savePath, &session->game);
+        free(savePath);
+    }
+    if (error != FITZ_OK) {
+        fprintf(session->out, "%s\n", fitz_error_message(error));
+        session->game = NULL;
+        return;
+    }
+
+    strcpy(session->playerTypes[0], words[2]);
+    strcpy(session->playerTypes[1], words[3]);
+    fitz_game_set_players(session->game, player_kind(words[2]),
+            player_kind(words[3]), SERVER_SEARCH_MS);
+    fitz_game_print(session->game, session->out);
+    display_next_tile(session->playerTypes[0], session->playerTypes[1],
+            session->game, session->out);
+    session_begin_turn(server, session);
+}
+
+/* Handles a human player's "row col rotate", "save path" or "hint" line. */
+static void session_human_line(Server* server, Session* session, char* line) {
+    char* outputPath = check_save_command(line);
+    FitzMove chosen;
+    FitzStep step;
+    if (strcmp(line, "hint") == 0) {
+        display_hint(session->game, SERVER_SEARCH_MS, session->out);
+    } else if (outputPath != NULL) {
+        char* savePath = find_save_path(server, outputPath, session->out);
+        if (savePath != NULL) {
+            FitzError error = fitz_game_save(session->game, savePath);
+            if (error != FITZ_OK) {
+                fprintf(session->out, "%s\n", fitz_error_message(error));
+            }
+            free(savePath);
+        }
+        free(outputPath);
+    } else if (fitz_parse_move(line, &chosen) == FITZ_OK &&
+            fitz_game_step(session->game, &chosen, &step) ==
+            FITZ_STEP_MOVED) {
+        session_finish_turn(server, session);
+        return;
+    }
+    prompt_player(fitz_game_next_player(session->game), session->out);
+}
+
+/* Dispatches one complete command line received from a session. */
+static void session_handle_line(Server* server, Session* session, char* line) {
+    if (session->pendingCommands++ == 0) {
+        session->pendingSince = fitz_now_millis() * 1e3;
+    }
+    if (strcmp(line, "stats") == 0) {
+        print_latency(session, session->out);
+        return;
+    }
+    if (strcmp(line, "quit") == 0) {
+        session_end_game(session);
+        session->state = SESSION_CLOSING;
+        return;
+    }
+    if (session->state == SESSION_HUMAN) {
+        session_human_line(server, session, line);
+        return;
+    }
+    if (session->state != SESSION_IDLE) {
+        // automated players are still moving; input is not expected yet
+        fprintf(session->out, "Invalid command\n");
+        return;
+    }
+    char* words[6];
+    int wordCount = split_words(line, words, 6);
+    if (wordCount > 0 && (strcmp(words[0], "new") == 0 ||
+            strcmp(words[0], "load") == 0)) {
+        session_start_game(server, session, words, wordCount);
+    } else {
+        fprintf(session->out, "Invalid command\n");
+    }
+}
+
+/* Handles each complete line in the input buffer for as long as the session
+is waiting for a command, keeping the rest buffered. */
+static void session_consume(Server* server, Session* session) {
+    int start = 0;
+    while (session->state == SESSION_HUMAN || session->state == SESSION_IDLE) {
+        char* newline = memchr(session->inBuffer + start, '\n',
+                session->inLength - start);
+        if (newline == NULL) {
+            break;
+        }
+        *newline = '\0';
+        char* line = session->inBuffer + start;
+        start = newline - session->inBuffer + 1;
+        if (session->discarding) {
+            fprintf(session->out, "Invalid command\n");
+            session->discarding = 0;
+        } else {
+            session_handle_line(server, session, line);
+        }
+    }
+    memmove(session->inBuffer, session->inBuffer + start,
+            session->inLength - start);
+    session->inLength -= start;
+    if (session->inLength == SERVER_LINE_LENGTH) {
+        session->discarding = 1;
+        session->inLength = 0;
+    }
+    if (session->endOfInput && (session->state == SESSION_HUMAN ||
+            session->state == SESSION_IDLE)) {
+        // a final unterminated line still counts
+        if (session->inLength > 0 && !session->discarding) {
+            session->inBuffer[session->inLength] = '\0';
+            session->inLength = 0;
+            session_handle_line(server, session, session->inBuffer);
+        }
+        if (session->state != SESSION_BOT) {
+            session_end_game(session);
+            session->state = SESSION_CLOSING;
+        }
+    }
+}
+
+/* Reads whatever the client has sent and handles each complete line. Returns
+1 if the session was closed. */
+static Bool session_read(Server* server, Session* session) {
+    while (!session->endOfInput && (session->state == SESSION_HUMAN ||
+            session->state == SESSION_IDLE)) {
+        ssize_t count = read(session->fd, session->inBuffer +
+                session->inLength, SERVER_LINE_LENGTH - session->inLength);
+        if (count == -1 && errno == EINTR) {
+            continue;
+        }
+        if (count == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (count <= 0) {
+            session->endOfInput = 1;
+        } else {
+            session->inLength += count;
+        }
+        session_consume(server, session);
+    }
+    return session_flush(server, session);
+}
+
+/* Accepts every pending connection on the listening socket. */
+static void server_accept(Server* server) {
+    while (1) {
+        int fd = accept(server->listenFd, NULL, NULL);
+        if (fd == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (set_nonblocking(fd) == -1) {
+            close(fd);
+            continue;
+        }
+        Session* session = calloc(1, sizeof(Session));
+        session->fd = fd;
+        session->id = server->nextSessionId++;
+        session->state = SESSION_IDLE;
+        session->events = EPOLLIN;
+        session->out = open_memstream(&session->outBuffer,
+                &session->outLength);
+        struct epoll_event event = {EPOLLIN, {session}};
+        if (epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            fclose(session->out);
+            free(session->outBuffer);
+            free(session);
+            close(fd);
+            continue;
+        }
+        server->sessionsOpen++;
+    }
+}
+
+/* Makes one automated move for every session that was queued when this call
+began, so that long bot-only games can't starve other sessions. */
+static void server_run_ready(Server* server) {
+    Session* last = server->readyTail;
+    Bool done = (last == NULL);
+    while (!done) {
+        Session* session = server->readyHead;
+        done = (session == last);
+        server->readyHead = session->nextReady;
+        if (server->readyHead == NULL) {
+            server->readyTail = NULL;
+        }
+        session->queued = 0;
+        if (session->fd == -1) {
+            free(session);
+            continue;
+        }
+        if (session->state != SESSION_BOT) {
+            continue;
+        }
+        FitzStep step;
+        if (fitz_game_step(session->game, NULL, &step) ==
+                FITZ_STEP_GAME_OVER) {
+            print_winner(fitz_game_next_player(session->game), session->out);
+            session_end_game(session);
+        } else {
+            automated_display(step.player, step.move.row, step.move.col,
+                    step.move.angle, session->out);
+            session_finish_turn(server, session);
+        }
+        // lines the client sent while the automated players moved
+        session_consume(server, session);
+        session_flush(server, session);
+    }
+}
+
+/* Runs the game server on the Unix domain socket at "socketPath", serving
+games with the tile files in "args", which may start with "--save-dir dir".
+Returns the exit status for the program. */
+int run_server(char* socketPath, char** args, int argCount) {
+    Server server;
+    memset(&server, 0, sizeof(server));
+    server.socketPath = socketPath;
+    if (argCount >= 2 && strcmp(args[0], "--save-dir") == 0) {
+        server.saveDir = args[1];
+        args += 2;
+        argCount -= 2;
+    }
+    char** tileFiles = args;
+    int tileFilesCount = argCount;
+    if (tileFilesCount < 1) {
+        fprintf(stderr, "Usage: fitz --server socketpath [--save-dir dir] "
+                "tilefile ...\n");
+        return 1;
+    }
+    for (int i = 0; i < tileFilesCount; i++) {
+        if (!add_library(&server, tileFiles[i])) {
+            return 3;
+        }
+    }
+    server.listenFd = server_listen(socketPath);
+    if (server.listenFd == -1) {
+        fprintf(stderr, "Can't listen on socket\n");
+        return 11;
+    }
+    server.epollFd = epoll_create1(0);
+    struct epoll_event listenEvent = {EPOLLIN, {NULL}};
+    epoll_ctl(server.epollFd, EPOLL_CTL_ADD, server.listenFd, &listenEvent);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = request_stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    while (!stopServer) {
+        int timeout = server.readyHead != NULL ? 0 : -1;
+        int count = epoll_wait(server.epollFd, events, SERVER_MAX_EVENTS,
+                timeout);
+        for (int i = 0; i < count; i++) {
+            Session* session = events[i].data.ptr;
+            if (session == NULL) {
+                server_accept(&server);
+            } else if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                session_read(&server, session);
+            } else if (events[i].events & EPOLLOUT) {
+                session_flush(&server, session);
+            }
+        }
+        server_run_ready(&server);
+    }
+
+    close(server.epollFd);
+    close(server.listenFd);
+    unlink(socketPath);
+    for (int i = 0; i < server.librariesCount; i++) {
+        fitz_tiles_free(server.libraries[i].tiles);
+        free(server.libraries[i].path);
+    }
+    free(server.libraries);
+    return 0;
+}
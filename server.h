@@ -0,0 +1,83 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "head.h"
+
+// maximum number of epoll events handled per wakeup
+#define SERVER_MAX_EVENTS 256
+// size of a session's input buffer; a command line longer than this is
+// discarded up to its newline and answered with "Invalid command"
+#define SERVER_LINE_LENGTH 256
+// number of log2 microsecond buckets in a session's latency histogram
+#define SERVER_LATENCY_BUCKETS 32
+// search time of automated player 3 and of hints, kept short because it
+// holds up every other session
+#define SERVER_SEARCH_MS 10
+
+// a tile file given on the command line, loaded once and shared (read only)
+// by every session using it
+typedef struct {
+    char* path;
+    FitzTiles* tiles;
+} TileLibrary;
+
+typedef enum {
+    SESSION_IDLE,       // connected but no game in progress
+    SESSION_HUMAN,      // waiting for a human player's move
+    SESSION_BOT,        // queued to make an automated move
+    SESSION_CLOSING     // flush remaining output then disconnect
+} SessionState;
+
+// per-session command latency, measured from receipt of a command line to
+// the moment the full reply has been written to the socket
+typedef struct {
+    long samples;
+    double totalMicros;
+    double maxMicros;
+    long buckets[SERVER_LATENCY_BUCKETS];
+} LatencyStats;
+
+typedef struct Session {
+    int fd;
+    int id;
+    SessionState state;
+    FitzGame* game;     // NULL while no game is in progress
+    char playerTypes[2][2];
+
+    char inBuffer[SERVER_LINE_LENGTH + 1];
+    int inLength;
+    Bool discarding;    // skipping the rest of an over-long line
+    Bool endOfInput;    // the client has shut down its side
+
+    FILE* out;          // memory stream collecting output not yet sent
+    char* outBuffer;
+    size_t outLength;
+    size_t outSent;
+    unsigned int events;    // epoll events currently registered
+
+    int pendingCommands;    // commands received but not yet fully answered
+    double pendingSince;    // receipt time of the oldest of those commands
+    LatencyStats latency;
+
+    struct Session* nextReady;
+    Bool queued;
+} Session;
+
+typedef struct {
+    int listenFd;
+    int epollFd;
+    char* socketPath;
+    TileLibrary* libraries;
+    int librariesCount;
+    // the directory of the files sessions may save and load (--save-dir), or
+    // NULL if they may not
+    char* saveDir;
+    Session* readyHead;
+    Session* readyTail;
+    int sessionsOpen;
+    int nextSessionId;
+} Server;
+
+int run_server(char* socketPath, char** args, int argCount);
+
+#endif
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simulate.h"
+#include "export.h"
+#include "timing.h"
+
+/* Plays "games" self-play games one at a time, each in its own FitzGame, as
+fitz --export does, adding their outcomes to "results". Returns the error if
+a game can't be started, otherwise FITZ_OK. */
+static FitzError simulate_singly(const FitzTiles* tiles, int rows, int cols,
+        const int bots[2], long randomPlies, uint64_t seed, long games,
+        FitzBatchResults* results) {
+    for (long gameNumber = 0; gameNumber < games; gameNumber++) {
+        FitzGame* game;
+        FitzError error = fitz_game_new(tiles, rows, cols, &game);
+        if (error != FITZ_OK) {
+            return error;
+        }
+        Random random = {seed + (uint64_t)gameNumber * EXPORT_GAME_SPACING,
+                0, 0};
+        FitzMove move;
+        long ply = 0;
+        while (self_play_move(game, &random, bots, ply, randomPlies, &move)) {
+            ply++;
+        }
+        results->games++;
+        results->wins[1 - fitz_game_next_player(game)]++;
+        results->plies += ply;
+        fitz_game_free(game);
+    }
+    return FITZ_OK;
+}
+
+/* Prints the usage message of "fitz --simulate" and returns its status. */
+static int simulation_usage(void) {
+    fprintf(stderr, "Usage: fitz --simulate [-n lanes | --single] "
+            "[--bots AB] [--random plies] tilefile height width games "
+            "seed\n");
+    return 1;
+}
+
+/* Runs "fitz --simulate [-n lanes | --single] [--bots AB] [--random plies]
+tilefile height width games seed": plays the same games as fitz --export
+would, "lanes" at a time in lockstep on a batch engine (by default
+SIMULATE_DEFAULT_LANES), or one at a time with "--single", and prints how
+many each player won and how many moves were made. The time taken goes to
+standard error. Returns the program's exit status. */
+int run_simulation(char** args, int argCount) {
+    long lanes = SIMULATE_DEFAULT_LANES;
+    long randomPlies = EXPORT_DEFAULT_RANDOM;
+    int bots[2] = {1, 2};
+    Bool single = 0;
+    int used = 0;
+    while (used < argCount && args[used][0] == '-') {
+        if (strcmp(args[used], "--single") == 0) {
+            single = 1;
+            used++;
+            continue;
+        }
+        if (used + 1 == argCount) {
+            return simulation_usage();
+        }
+        if (strcmp(args[used], "-n") == 0) {
+            if (!parse_count(args[used + 1], 1, SIMULATE_MAX_LANES, &lanes)) {
+                return simulation_usage();
+            }
+        } else if (strcmp(args[used], "--bots") == 0 &&
+                strlen(args[used + 1]) == 2 &&
+                strspn(args[used + 1], "12") == 2) {
+            bots[0] = args[used + 1][0] - '0';
+            bots[1] = args[used + 1][1] - '0';
+        } else if (strcmp(args[used], "--random") != 0 ||
+                !parse_count(args[used + 1], 0, 0xffff, &randomPlies)) {
+            return simulation_usage();
+        }
+        used += 2;
+    }
+    long rows, cols, games, seed;
+    if (argCount - used != 5 ||
+            !parse_count(args[used + 1], 1, FITZ_MAX_DIMENSION, &rows) ||
+            !parse_count(args[used + 2], 1, FITZ_MAX_DIMENSION, &cols) ||
+            !parse_count(args[used + 3], 1, 0x7fffffffL, &games) ||
+            !parse_count(args[used + 4], 0, 0x7fffffffL, &seed)) {
+        return simulation_usage();
+    }
+    FitzTiles* tiles = load_tiles(args[used]);
+    FitzBatchResults results = {0, {0, 0}, 0};
+    double start = fitz_now_millis();
+    if (single) {
+        FitzError error = simulate_singly(tiles, (int)rows, (int)cols, bots,
+                randomPlies, (uint64_t)seed, games, &results);
+        if (error != FITZ_OK) {
+            fitz_tiles_free(tiles);
+            exit_with_error(error);
+        }
+    } else {
+        FitzBatch* batch;
+        FitzError error = fitz_batch_new(tiles, (int)rows, (int)cols,
+                (int)lanes, bots, (int)randomPlies, (uint64_t)seed, &batch);
+        if (error != FITZ_OK) {
+            fitz_tiles_free(tiles);
+            exit_with_error(error);
+        }
+        fitz_batch_run(batch, games, &results);
+        fitz_batch_free(batch);
+    }
+    double seconds = (fitz_now_millis() - start) / 1000;
+    printf("Games: %ld\nWins: * %ld # %ld\nPlies: %ld\n", results.games,
+            results.wins[0], results.wins[1], results.plies);
+    if (single) {
+        fprintf(stderr, "%ld games in %.3f s (%.0f games/s, one at a "
+                "time)\n", games, seconds,
+                seconds > 0 ? games / seconds : 0.0);
+    } else {
+        fprintf(stderr, "%ld games in %.3f s (%.0f games/s, %ld lanes)\n",
+                games, seconds, seconds > 0 ? games / seconds : 0.0, lanes);
+    }
+    fitz_tiles_free(tiles);
+    return 0;
+}
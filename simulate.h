@@ -0,0 +1,13 @@
+#ifndef SIMULATE_H
+#define SIMULATE_H
+
+#include "head.h"
+
+// games a batch engine plays at once unless "-n" says otherwise
+#define SIMULATE_DEFAULT_LANES 256
+#define SIMULATE_MAX_LANES 65536
+
+//function prototypes
+int run_simulation(char** args, int argCount);
+
+#endif
@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "internal.h"
+
+
+/* Reads the whole of the file stream "input" into a new buffer, storing its
+length in "length". */
+static char* read_all(FILE* input, long* length) {
+    rewind(input);
+    long capacity = 256;
+    char* data = malloc(capacity);
+    *length = 0;
+    int next;
+    while ((next = fgetc(input)) != EOF) {
+        if (*length == capacity) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+        }
+        data[(*length)++] = (char)next;
+    }
+    return data;
+}
+
+/* Checks that the "size" rows of "size" characters at "tile" are a valid
+tile: ',' or '!' characters, each row ended by '\n'. Returns 1 if no,
+otherwise 0. */
+static Bool check_tile(const char* tile, int size) {
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            char cell = tile[i * (size + 1) + j];
+            if (cell != ',' && cell != '!') {
+                return 1;
+            }
+        }
+        if (tile[i * (size + 1) + size] != '\n') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Given a file stream to the tile file, reads the tiles into "library": each
+tile is "size" rows of "size" characters, where "size" is the length of the
+file's first line (at most FITZ_MAX_TILE_SIZE), and tiles are separated by
+an empty line. Returns 1 if the file isn't correctly formatted, otherwise
+0. */
+Bool read_tiles(FILE* tileFile, FitzTiles* library) {
+    long length;
+    char* data = read_all(tileFile, &length);
+    char* newline = memchr(data, '\n', length);
+    int size = newline == NULL ? 0 : newline - data;
+    if (size < 1 || size > FITZ_MAX_TILE_SIZE) {
+        free(data);
+        return 1;
+    }
+    int tileLength = size * (size + 1);
+    library->size = size;
+    library->margin = size / 2;
+    library->tilesCount = 0;
+    library->tiles = NULL;
+    long position = 0;
+    while (1) {
+        if (length - position < tileLength ||
+                check_tile(data + position, size)) {
+            break;
+        }
+        library->tiles = realloc(library->tiles,
+                sizeof(char*) * (library->tilesCount + 1));
+        char* tile = malloc(sizeof(char) * tileLength);
+        memcpy(tile, data + position, tileLength);
+        library->tiles[library->tilesCount++] = tile;
+        position += tileLength;
+        if (position == length) {
+            free(data);
+            return 0;
+        }
+        // the next tile must follow a single empty line
+        if (data[position] != '\n' || position + 1 == length) {
+            break;
+        }
+        position++;
+    }
+    free_tiles_mem(library->tiles, library->tilesCount);
+    free(data);
+    return 1;
+}
+
+/* Returns the markers of a tile (as in a tile file) as a mask: row i and
+column j of the tile is bit 8 * i + j. */
+uint64_t tile_mask(const char* tile, int size) {
+    uint64_t mask = 0;
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            if (tile[i * (size + 1) + j] == '!') {
+                mask |= (uint64_t)1 << (8 * i + j);
+            }
+        }
+    }
+    return mask;
+}
+
+/* Rotates the mask of a "size" x "size" tile clockwise by "angle" (0, 90, 180
+or 270) and returns the rotated mask. */
+uint64_t rotate_mask(uint64_t mask, int size, int angle) {
+    uint64_t rotated = 0;
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            if (!((mask >> (8 * i + j)) & 1)) {
+                continue;
+            }
+            int row = i;
+            int col = j;
+            if (angle == 90) {
+                row = j;
+                col = size - 1 - i;
+            } else if (angle == 180) {
+                row = size - 1 - i;
+                col = size - 1 - j;
+            } else if (angle == 270) {
+                row = size - 1 - j;
+                col = i;
+            }
+            rotated |= (uint64_t)1 << (8 * row + col);
+        }
+    }
+    return rotated;
+}
+
+/* Given the tile library, display to "out" the tiles with their rotations. */
+void shape_display(const FitzTiles* library, FILE* out) {
+    int size = library->size;
+    for (int i = 0; i < library->tilesCount; i++) {
+        uint64_t rotated[4];
+        for (int a = 0; a < 4; a++) {
+            rotated[a] = rotate_mask(tile_mask(library->tiles[i], size), size,
+                    a * 90);
+        }
+
+        // display the different rotations side by side
+        for (int row = 0; row < size; row++) {
+            for (int a = 0; a < 4; a++) {
+                for (int col = 0; col < size; col++) {
+                    fputc((rotated[a] >> (8 * row + col)) & 1 ? '!' : ',',
+                            out);
+                }
+                fputc(a < 3 ? ' ' : '\n', out);
+            }
+        }
+
+        // if this is the last set of rotations, output a new line to stdout to
+        // follow the specification
+        if(i <= library->tilesCount - 2) {
+            fprintf(out, "\n");
+        }
+    }
+}
+
+/* A function that frees a "tiles" array. */
+void free_tiles_mem(char** tiles, int tilesCount) {
+    for (int i = 0; i < tilesCount; i++) {
+        free(tiles[i]);
+    }
+    free(tiles);
+}
+
+/* Stores in "shape" the markers of a tile rotated by "angle": their offsets
+relative to the tile's centre, row (size - 1) / 2 and column (size - 1) / 2,
+and their mask over the box around them. */
+void build_tile_shape(const char* tile, int size, int angle,
+        TileShape* shape) {
+    uint64_t rotated = rotate_mask(tile_mask(tile, size), size, angle);
+    int centre = (size - 1) / 2;
+    shape->count = 0;
+    shape->minDy = shape->minDx = size;
+    shape->maxDy = shape->maxDx = -size;
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            if ((rotated >> (8 * i + j)) & 1) {
+                int dy = i - centre;
+                int dx = j - centre;
+                shape->dy[shape->count] = dy;
+                shape->dx[shape->count] = dx;
+                shape->count++;
+                shape->minDy = dy < shape->minDy ? dy : shape->minDy;
+                shape->maxDy = dy > shape->maxDy ? dy : shape->maxDy;
+                shape->minDx = dx < shape->minDx ? dx : shape->minDx;
+                shape->maxDx = dx > shape->maxDx ? dx : shape->maxDx;
+            }
+        }
+    }
+    shape->mask = 0;
+    for (int m = 0; m < shape->count; m++) {
+        shape->mask |= (uint64_t)1 << (8 * (shape->dy[m] - shape->minDy) +
+                shape->dx[m] - shape->minDx);
+    }
+}
+
+/* Loads the tiles from the tile file at "path" into a new tile library. The
+library is never modified afterwards, so any number of games may share it. */
+FitzError fitz_tiles_load(const char* path, FitzTiles** tilesPtr) {
+    FILE* tileFile = fopen(path, "r");
+    if (tileFile == NULL) {
+        return FITZ_ERR_TILE_ACCESS;
+    }
+    FitzTiles* library = malloc(sizeof(FitzTiles));
+    if (read_tiles(tileFile, library) == 1) {
+        free(library);
+        fclose(tileFile);
+        return FITZ_ERR_TILE_CONTENTS;
+    }
+    library->shapes = malloc(sizeof(TileShape) * 4 * library->tilesCount);
+    for (int i = 0; i < library->tilesCount; i++) {
+        for (int angle = 0; angle < 360; angle += 90) {
+            build_tile_shape(library->tiles[i], library->size, angle,
+                    &library->shapes[i * 4 + angle / 90]);
+        }
+    }
+    library->hash = hash_tiles(library);
+    fclose(tileFile);
+    *tilesPtr = library;
+    return FITZ_OK;
+}
+
+/* Frees a tile library. No game may still be using it. */
+void fitz_tiles_free(FitzTiles* tiles) {
+    free_tiles_mem(tiles->tiles, tiles->tilesCount);
+    free(tiles->shapes);
+    free(tiles);
+}
+
+/* Returns the number of tiles in a tile library. */
+int fitz_tiles_count(const FitzTiles* tiles) {
+    return tiles->tilesCount;
+}
+
+/* Returns the height and width of the tiles of a tile library. */
+int fitz_tiles_size(const FitzTiles* tiles) {
+    return tiles->size;
+}
+
+/* Writes the tile at "index" to "out" as it appears in the tile file. */
+void fitz_tiles_print(const FitzTiles* tiles, int index, FILE* out) {
+    fwrite(tiles->tiles[index], sizeof(char),
+            tiles->size * (tiles->size + 1), out);
+}
+
+/* Writes every tile of a tile library to "out" with its four rotations side by
+side. */
+void fitz_tiles_display(const FitzTiles* tiles, FILE* out) {
+    shape_display(tiles, out);
+}
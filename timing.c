@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include "timing.h"
+
+/* Sets up a timed line reader on the file descriptor "fd". */
+void timed_input_init(TimedInput* input, int fd) {
+    input->fd = fd;
+    input->length = 0;
+    input->discarding = 0;
+    input->endOfInput = 0;
+}
+
+/* Takes the first "length" buffered bytes as a line and stores a copy of it
+in "*line". */
+static void take_line(TimedInput* input, int length, int consumed,
+        char** line) {
+    *line = malloc(length + 1);
+    memcpy(*line, input->buffer, length);
+    (*line)[length] = '\0';
+    input->length -= consumed;
+    memmove(input->buffer, input->buffer + consumed, input->length);
+}
+
+/* Reads the next line (without its newline) into a new string "*line",
+waiting for input no later than "deadline" (in milliseconds on the monotonic
+clock). As with read_line(), a last line without a newline only counts if it
+is a valid move. */
+InputStatus read_line_before(TimedInput* input, double deadline,
+        char** line) {
+    while (1) {
+        char* newline = memchr(input->buffer, '\n', input->length);
+        if (newline != NULL) {
+            int length = newline - input->buffer;
+            Bool dropped = input->discarding;
+            input->discarding = 0;
+            take_line(input, length, length + 1, line);
+            if (!dropped) {
+                return INPUT_OK;
+            }
+            free(*line);
+            continue;
+        }
+        if (input->length == TIMED_LINE_LENGTH) {
+            // keep the start of an overlong line, which is invalid anyway
+            if (!input->discarding) {
+                take_line(input, input->length, input->length, line);
+                input->discarding = 1;
+                return INPUT_OK;
+            }
+            input->length = 0;
+        }
+        if (input->endOfInput) {
+            if (input->length == 0 || input->discarding) {
+                return INPUT_END;
+            }
+            take_line(input, input->length, input->length, line);
+            FitzMove check;
+            if (fitz_parse_move(*line, &check) != FITZ_OK) {
+                free(*line);
+                return INPUT_END;
+            }
+            return INPUT_OK;
+        }
+        int remaining = (int)(deadline - fitz_now_millis());
+        if (remaining <= 0) {
+            return INPUT_TIMEOUT;
+        }
+        struct pollfd ready = {input->fd, POLLIN, 0};
+        if (poll(&ready, 1, remaining) <= 0) {
+            continue;
+        }
+        ssize_t count = read(input->fd, input->buffer + input->length,
+                TIMED_LINE_LENGTH - input->length);
+        if (count > 0) {
+            input->length += count;
+        } else if (count == 0 || errno != EINTR) {
+            input->endOfInput = 1;
+        }
+    }
+}
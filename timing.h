@@ -0,0 +1,27 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include "head.h"
+
+// longest human input line kept; the rest of a longer line is dropped
+#define TIMED_LINE_LENGTH 128
+
+typedef enum {
+    INPUT_OK,
+    INPUT_TIMEOUT,      // no complete line before the deadline
+    INPUT_END           // end of input
+} InputStatus;
+
+// a line reader over a file descriptor that never waits past a deadline
+struct TimedInput {
+    int fd;
+    char buffer[TIMED_LINE_LENGTH];
+    int length;
+    Bool discarding;    // dropping the rest of an overlong line
+    Bool endOfInput;
+};
+
+void timed_input_init(TimedInput* input, int fd);
+InputStatus read_line_before(TimedInput* input, double deadline, char** line);
+
+#endif
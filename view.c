@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "view.h"
+
+/* Parses a viewport size "HEIGHTxWIDTH" into "view", which then follows the
+last move. Returns 0 if the size is invalid. */
+Bool parse_viewport_size(const char* arg, Viewport* view) {
+    int height, width;
+    char extra;
+    if (sscanf(arg, "%dx%d%c", &height, &width, &extra) != 2 ||
+            height < 1 || width < 1 || height > VIEW_MAX_SIZE ||
+            width > VIEW_MAX_SIZE) {
+        return 0;
+    }
+    view->height = height;
+    view->width = width;
+    view->following = 1;
+    return 1;
+}
+
+/* Returns the first of "size" consecutive positions centred on "centre",
+kept within the "length" positions there are. */
+static int window_start(int centre, int size, int length) {
+    int start = centre - size / 2;
+    if (start > length - size) {
+        start = length - size;
+    }
+    return start < 0 ? 0 : start;
+}
+
+/* Finds the cell the viewport is centred on: the last move's anchor if it is
+following moves (the middle of the board before any move), or else the cell
+it was moved to. */
+static void viewport_centre(const FitzGame* currentGame, const Viewport* view,
+        int* row, int* col) {
+    if (!view->following) {
+        *row = view->centreRow;
+        *col = view->centreCol;
+    } else if (!fitz_game_last_move(currentGame, row, col)) {
+        *row = fitz_game_rows(currentGame) / 2;
+        *col = fitz_game_cols(currentGame) / 2;
+    }
+}
+
+/* Writes the part of the board inside the viewport to "out", under a ruler
+numbering every tenth column and with each row's number in front of it. Only
+the cells shown are read, so this costs the same on any size of board. */
+void print_viewport(const FitzGame* currentGame, Viewport* view, FILE* out) {
+    int rows = fitz_game_rows(currentGame);
+    int cols = fitz_game_cols(currentGame);
+    int centreRow, centreCol;
+    viewport_centre(currentGame, view, &centreRow, &centreCol);
+    int height = view->height < rows ? view->height : rows;
+    int width = view->width < cols ? view->width : cols;
+    int top = window_start(centreRow, height, rows);
+    int left = window_start(centreCol, width, cols);
+
+    // column numbers start at their column, as does the first column's if
+    // it has room before the next tenth column; "|" marks each tenth column
+    char* ruler = malloc(width + 12);
+    memset(ruler, ' ', width + 12);
+    int end = 0;
+    for (int c = left; c < left + width; c++) {
+        char number[12];
+        int length = sprintf(number, "%d", c);
+        if ((c % 10 == 0 || (c == left && length < 10 - c % 10)) &&
+                c - left >= end) {
+            memcpy(ruler + (c - left), number, length);
+            end = c - left + length + 1;
+        }
+    }
+    ruler[end > 0 ? end - 1 : 0] = '\0';
+    fprintf(out, "%*s%s\n", VIEW_RULER_WIDTH + 1, "", ruler);
+    for (int c = left; c < left + width; c++) {
+        ruler[c - left] = c % 10 == 0 ? '|' : (c % 5 == 0 ? '+' : '-');
+    }
+    ruler[width] = '\0';
+    fprintf(out, "%*s%s\n", VIEW_RULER_WIDTH + 1, "", ruler);
+    free(ruler);
+
+    const char* grid = fitz_game_grid(currentGame);
+    for (int r = top; r < top + height; r++) {
+        fprintf(out, "%*d ", VIEW_RULER_WIDTH, r);
+        fwrite(grid + (long)r * (cols + 1) + left, 1, width, out);
+        fputc('\n', out);
+    }
+}
+
+/* Carries out a viewport command from a human player: "view r c" centres the
+viewport on row r and column c, "view" makes it follow the last move again
+and "pan up|down|left|right [n]" moves it n cells (by default half the
+viewport). The viewport is shown again afterwards. Returns 0 if "input" is not
+a viewport command. */
+Bool viewport_command(const FitzGame* currentGame, Viewport* view,
+        const char* input) {
+    int row, col, amount;
+    char direction[8];
+    char extra;
+    if (strcmp(input, "view") == 0) {
+        view->following = 1;
+    } else if (sscanf(input, "view %d %d%c", &row, &col, &extra) == 2) {
+        view->following = 0;
+        view->centreRow = row;
+        view->centreCol = col;
+    } else if (strncmp(input, "pan ", 4) == 0) {
+        int fields = sscanf(input, "pan %7s %d%c", direction, &amount,
+                &extra);
+        Bool vertical = strcmp(direction, "up") == 0 ||
+                strcmp(direction, "down") == 0;
+        Bool horizontal = strcmp(direction, "left") == 0 ||
+                strcmp(direction, "right") == 0;
+        if (fields == 1) {
+            amount = (vertical ? view->height : view->width) / 2;
+        } else if (fields != 2 || amount < 0) {
+            return 0;
+        }
+        if (!vertical && !horizontal) {
+            return 0;
+        }
+        // pan from where the viewport actually is, not from off the board
+        int rows = fitz_game_rows(currentGame);
+        int cols = fitz_game_cols(currentGame);
+        int height = view->height < rows ? view->height : rows;
+        int width = view->width < cols ? view->width : cols;
+        // the viewport can't move further than the board is long, and capping
+        // the amount there keeps the sums below from overflowing
+        int limit = vertical ? rows : cols;
+        if (amount > limit) {
+            amount = limit;
+        }
+        viewport_centre(currentGame, view, &row, &col);
+        row = window_start(row, height, rows) + height / 2;
+        col = window_start(col, width, cols) + width / 2;
+        if (strcmp(direction, "up") == 0) {
+            row -= amount;
+        } else if (strcmp(direction, "down") == 0) {
+            row += amount;
+        } else if (strcmp(direction, "left") == 0) {
+            col -= amount;
+        } else {
+            col += amount;
+        }
+        view->following = 0;
+        view->centreRow = row;
+        view->centreCol = col;
+    } else {
+        return 0;
+    }
+    print_viewport(currentGame, view, stdout);
+    return 1;
+}
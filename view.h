@@ -0,0 +1,17 @@
+#ifndef VIEW_H
+#define VIEW_H
+
+#include "head.h"
+
+// width of the row numbers in front of each row of a viewport
+#define VIEW_RULER_WIDTH 4
+// largest viewport height or width
+#define VIEW_MAX_SIZE 999
+
+//function prototypes
+Bool parse_viewport_size(const char* arg, Viewport* view);
+void print_viewport(const FitzGame* currentGame, Viewport* view, FILE* out);
+Bool viewport_command(const FitzGame* currentGame, Viewport* view,
+        const char* input);
+
+#endif